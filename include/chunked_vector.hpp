@@ -0,0 +1,183 @@
+#pragma once
+#include "memory"
+#include "new"
+#include "utility"
+#include "vector"
+
+namespace cs251 {
+	/**
+	 * Indexed storage made of fixed-size chunks. Growing only adds chunks, so elements are never moved or copied
+	 * and references to them stay valid until they are destroyed; only the small table of chunk pointers reallocates.
+	 */
+	template <typename value_type>
+	class chunked_vector {
+	public:
+		/**
+		 * The amount of elements in a chunk, as a power of two so an index splits with a shift and a mask.
+		 */
+		static const size_t chunk_bits = 10;
+		static const size_t chunk_size = static_cast<size_t>(1) << chunk_bits;
+
+		template <typename element_type, typename owner_type>
+		class basic_iterator {
+		public:
+			basic_iterator(owner_type* owner, size_t index) : m_owner(owner), m_index(index) {}
+			element_type& operator*() const { return (*m_owner)[m_index]; }
+			element_type* operator->() const { return &(*m_owner)[m_index]; }
+			basic_iterator& operator++() { m_index++; return *this; }
+			bool operator==(const basic_iterator& other) const { return m_index == other.m_index; }
+			bool operator!=(const basic_iterator& other) const { return m_index != other.m_index; }
+		private:
+			owner_type* m_owner;
+			size_t m_index;
+		};
+		typedef basic_iterator<value_type, chunked_vector> iterator;
+		typedef basic_iterator<const value_type, const chunked_vector> const_iterator;
+
+		chunked_vector() = default;
+		chunked_vector(const chunked_vector&) = delete;
+		chunked_vector& operator=(const chunked_vector&) = delete;
+		chunked_vector(chunked_vector&& other) noexcept;
+		chunked_vector& operator=(chunked_vector&& other) noexcept;
+		~chunked_vector();
+
+		value_type& operator[](size_t index) { return m_chunks[index >> chunk_bits][index & (chunk_size - 1)]; }
+		const value_type& operator[](size_t index) const { return m_chunks[index >> chunk_bits][index & (chunk_size - 1)]; }
+		iterator begin() { return iterator(this, 0); }
+		iterator end() { return iterator(this, m_size); }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, m_size); }
+
+		/**
+		 * \brief Get the amount of elements.
+		 * \return The amount of elements.
+		 */
+		size_t size() const { return m_size; }
+		/**
+		 * \brief Check if there are no elements.
+		 * \return If there are no elements.
+		 */
+		bool empty() const { return m_size == 0; }
+		/**
+		 * \brief Get the amount of elements that fit in the chunks already allocated.
+		 * \return The capacity.
+		 */
+		size_t capacity() const { return m_chunks.size() * chunk_size; }
+		/**
+		 * \brief Construct an element at the end, allocating a chunk when the last one is full.
+		 * \param arguments The arguments of the constructor.
+		 * \return The new element.
+		 */
+		template <typename... argument_types>
+		value_type& emplace_back(argument_types&&... arguments);
+		/**
+		 * \brief Grow or shrink to a size.
+		 * \param count The new amount of elements.
+		 * \param value The value new elements are copied from.
+		 */
+		void resize(size_t count, const value_type& value = value_type());
+		/**
+		 * \brief Allocate the chunks for a capacity up front, so growing to it allocates nothing.
+		 * \param count The amount of elements to make room for.
+		 */
+		void reserve(size_t count);
+		/**
+		 * \brief Destroy every element, keeping the chunks for reuse.
+		 */
+		void clear();
+	private:
+		/**
+		 * \brief Allocate one more chunk of uninitialized elements.
+		 */
+		void add_chunk();
+
+		/**
+		 * The chunks, each holding chunk_size elements of which the first m_size in total are constructed.
+		 */
+		std::vector<value_type*> m_chunks {};
+		/**
+		 * The amount of constructed elements.
+		 */
+		size_t m_size = 0;
+	};
+
+	template <typename value_type>
+	chunked_vector<value_type>::chunked_vector(chunked_vector&& other) noexcept : m_chunks(std::move(other.m_chunks)), m_size(other.m_size) {
+        other.m_chunks.clear();
+        other.m_size = 0;
+	}
+
+	template <typename value_type>
+	chunked_vector<value_type>& chunked_vector<value_type>::operator=(chunked_vector&& other) noexcept {
+        if (this != &other) {
+            clear();
+            for (value_type* chunk : m_chunks) {
+                std::allocator<value_type>().deallocate(chunk, chunk_size);
+            }
+            m_chunks = std::move(other.m_chunks);
+            m_size = other.m_size;
+            other.m_chunks.clear();
+            other.m_size = 0;
+        }
+        return *this;
+	}
+
+	template <typename value_type>
+	chunked_vector<value_type>::~chunked_vector() {
+        clear();
+        for (value_type* chunk : m_chunks) {
+            std::allocator<value_type>().deallocate(chunk, chunk_size);
+        }
+	}
+
+	template <typename value_type>
+	template <typename... argument_types>
+	value_type& chunked_vector<value_type>::emplace_back(argument_types&&... arguments) {
+        if (m_size == capacity()) {
+            add_chunk();
+        }
+        value_type* element = &m_chunks[m_size >> chunk_bits][m_size & (chunk_size - 1)];
+        new (element) value_type(std::forward<argument_types>(arguments)...);
+        m_size += 1;
+        return *element;
+	}
+
+	template <typename value_type>
+	void chunked_vector<value_type>::resize(const size_t count, const value_type& value) {
+        while (m_size > count) {
+            m_size -= 1;
+            (*this)[m_size].~value_type();
+        }
+        reserve(count);
+        while (m_size < count) {
+            emplace_back(value);
+        }
+	}
+
+	template <typename value_type>
+	void chunked_vector<value_type>::reserve(const size_t count) {
+        m_chunks.reserve((count + chunk_size - 1) >> chunk_bits);
+        while (capacity() < count) {
+            add_chunk();
+        }
+	}
+
+	template <typename value_type>
+	void chunked_vector<value_type>::clear() {
+        while (m_size > 0) {
+            m_size -= 1;
+            (*this)[m_size].~value_type();
+        }
+	}
+
+	template <typename value_type>
+	void chunked_vector<value_type>::add_chunk() {
+        value_type* chunk = std::allocator<value_type>().allocate(chunk_size);
+        try {
+            m_chunks.push_back(chunk);
+        } catch (...) {
+            std::allocator<value_type>().deallocate(chunk, chunk_size);
+            throw;
+        }
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "filesystem.hpp"
+#include "mutex"
+#include "shared_mutex"
+
+namespace cs251 {
+	/**
+	 * A filesystem that can be shared between threads. Lookups take a shared lock and go through the read-only
+	 * peek paths of the filesystem, which skip the path cache and the link memos, so any number of them run at once.
+	 * Mutations take the lock exclusively and are serialized.
+	 */
+	class concurrent_filesystem {
+	public:
+		/**
+		 * \brief Create a shared filesystem.
+		 * \param sizeLimit The size limit of the filesystem.
+		 */
+		explicit concurrent_filesystem(size_t sizeLimit);
+
+		/**
+		 * \brief Create a file under a directory, see filesystem::create_file.
+		 * \param fileSize The size of the file.
+		 * \param fileName The name of the file.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \return The handle of the file.
+		 */
+		handle create_file(size_t fileSize, const std::string& fileName, handle parentHandle = 0);
+
+		/**
+		 * \brief Create a directory under a directory, see filesystem::create_directory.
+		 * \param directoryName The name of the directory.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \return The handle of the directory.
+		 */
+		handle create_directory(const std::string& directoryName, handle parentHandle = 0);
+
+		/**
+		 * \brief Create a link under a directory, see filesystem::create_link.
+		 * \param targetHandle The handle of the linked target.
+		 * \param linkName The name of the link.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \return The handle of the link.
+		 */
+		handle create_link(handle targetHandle, const std::string& linkName, handle parentHandle = 0);
+
+		/**
+		 * \brief Delete the file, link or empty directory, see filesystem::remove.
+		 * \param targetHandle The handle of the target.
+		 * \return If the target is removed.
+		 */
+		bool remove(handle targetHandle);
+
+		/**
+		 * \brief Delete the target and everything below it, see filesystem::remove_recursive.
+		 * \param targetHandle The handle of the target.
+		 * \return The amount of removed nodes.
+		 */
+		size_t remove_recursive(handle targetHandle);
+
+		/**
+		 * \brief Change the size of a file, see filesystem::resize_file.
+		 * \param targetHandle The handle of the file, or a link to it.
+		 * \param newSize The new size of the file.
+		 */
+		void resize_file(handle targetHandle, size_t newSize);
+
+		/**
+		 * \brief Move the target under another directory, see filesystem::move.
+		 * \param targetHandle The handle of the target.
+		 * \param parentHandle The handle of the new parent directory, or a link to it.
+		 */
+		void move(handle targetHandle, handle parentHandle);
+
+		/**
+		 * \brief Rename the target, see filesystem::rename.
+		 * \param targetHandle The handle of the target.
+		 * \param newName The new name.
+		 */
+		void rename(handle targetHandle, const std::string& newName);
+
+		/**
+		 * \brief Resolve a path under the shared lock, see filesystem::peek_handle.
+		 * \param path The path, absolute when it starts with '/' and relative to the start otherwise.
+		 * \param startHandle The directory, or link to one, that relative paths start from.
+		 * \return The handle to the target.
+		 */
+		handle get_handle(std::string_view path, handle startHandle = 0) const;
+
+		/**
+		 * \brief Check if the target exists, under the shared lock.
+		 * \param targetHandle The handle of the target.
+		 * \return If the target exists.
+		 */
+		bool exist(handle targetHandle) const;
+
+		/**
+		 * \brief Get the name of the target, under the shared lock.
+		 * \param targetHandle The handle of the target.
+		 * \return A copy of the name, since the node may be renamed once the lock is released.
+		 */
+		std::string get_name(handle targetHandle) const;
+
+		/**
+		 * \brief Get the size of the file by handle, under the shared lock.
+		 * \param targetHandle The handle of the file, or a link to it.
+		 * \return The size of the file.
+		 */
+		size_t get_file_size(handle targetHandle) const;
+
+		/**
+		 * \brief Get the size of the file by path, resolving and reading it under one shared lock.
+		 * \param path The absolute path of the file, or a link to it.
+		 * \return The size of the file.
+		 */
+		size_t get_file_size(std::string_view path) const;
+
+		/**
+		 * \brief Get the largest file, under the shared lock.
+		 * \return The handle of the largest file.
+		 */
+		handle get_largest_file_handle() const;
+
+		/**
+		 * \brief Run anything else on the filesystem, such as snapshots or the operation log, with the lock held exclusively.
+		 * \param action Called with the filesystem.
+		 * \return What the action returns.
+		 */
+		template <typename function>
+		auto with_exclusive(function action) -> decltype(action(std::declval<filesystem&>())) {
+			std::unique_lock<std::shared_mutex> lock(m_mutex);
+			return action(m_fileSystem);
+		}
+
+		/**
+		 * \brief Run several lookups that must see the same state with the lock held shared. The action may only
+		 * use the const members of the filesystem, which read without writing any cache.
+		 * \param action Called with the filesystem.
+		 * \return What the action returns.
+		 */
+		template <typename function>
+		auto with_shared(function action) const -> decltype(action(std::declval<const filesystem&>())) {
+			std::shared_lock<std::shared_mutex> lock(m_mutex);
+			return action(m_fileSystem);
+		}
+	private:
+		/**
+		 * The filesystem being shared.
+		 */
+		filesystem m_fileSystem;
+		/**
+		 * Held shared by lookups and exclusively by mutations.
+		 */
+		mutable std::shared_mutex m_mutex;
+	};
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "vector"
+#include "utility"
+#include "tree.hpp"
+
+namespace cs251 {
+	struct file_size_index_node
+	{
+		/**
+		 * The size of the file, used for sorting.
+		 */
+		size_t m_value = 0;
+		/**
+		 * The handle of the file, used to order files of the same size.
+		 */
+		handle m_handle = -1;
+		/**
+		 * The random priority that keeps the treap balanced.
+		 */
+		unsigned int m_priority = 0;
+		/**
+		 * The position of the left child, -1 if none.
+		 */
+		int m_left = -1;
+		/**
+		 * The position of the right child, -1 if none.
+		 */
+		int m_right = -1;
+		/**
+		 * The amount of files in this subtree.
+		 */
+		size_t m_count = 0;
+		/**
+		 * The total size of the files in this subtree.
+		 */
+		size_t m_bytes = 0;
+	};
+	/**
+	 * Order statistics over file sizes: a treap ordered by (size, handle) where every node
+	 * also keeps the file count and byte total of its subtree, so range queries take O(log n).
+	 */
+	class file_size_index {
+	public:
+		/**
+		 * \brief Register a file.
+		 * \param fileSize The size of the file.
+		 * \param handle The handle of the file.
+		 */
+		void insert(size_t fileSize, handle handle);
+
+		/**
+		 * \brief Register many files at once. Into an empty index the treap is built directly from the sorted files.
+		 * \param files The sizes and handles of the files.
+		 */
+		void insert_all(std::vector<std::pair<size_t, handle>> files);
+
+		/**
+		 * \brief Unregister a file.
+		 * \param fileSize The size the file was registered with.
+		 * \param handle The handle of the file.
+		 */
+		void remove(size_t fileSize, handle handle);
+
+		/**
+		 * \brief Count the files with minSize <= size <= maxSize.
+		 * \param minSize The lower bound, inclusive.
+		 * \param maxSize The upper bound, inclusive.
+		 * \return The amount of files in the range.
+		 */
+		size_t count_in_range(size_t minSize, size_t maxSize) const;
+
+		/**
+		 * \brief Sum the sizes of the files with minSize <= size <= maxSize.
+		 * \param minSize The lower bound, inclusive.
+		 * \param maxSize The upper bound, inclusive.
+		 * \return The total size of the files in the range.
+		 */
+		size_t bytes_in_range(size_t minSize, size_t maxSize) const;
+
+		/**
+		 * \brief Get the amount of registered files.
+		 * \return The amount of files.
+		 */
+		size_t size() const;
+	private:
+		/**
+		 * \brief Count and sum the files with size <= maxSize.
+		 * \param maxSize The upper bound, inclusive.
+		 * \param count Receives the amount of files.
+		 * \param bytes Receives the total size of the files.
+		 */
+		void prefix(size_t maxSize, size_t& count, size_t& bytes) const;
+
+		/**
+		 * \brief Split a subtree into the nodes ordered before (value, handle) and the rest.
+		 */
+		void split(int root, size_t value, handle handle, int& left, int& right);
+
+		/**
+		 * \brief Merge two subtrees where every node of left is ordered before every node of right.
+		 * \return The root of the merged subtree.
+		 */
+		int merge(int left, int right);
+
+		/**
+		 * \brief Recompute the count and byte total of a node from its children.
+		 * \param index The position of the node.
+		 */
+		void refresh(int index);
+
+		/**
+		 * \brief Take a recycled node or add a new one, with a fresh priority.
+		 * \param fileSize The size of the file.
+		 * \param handle The handle of the file.
+		 * \return The position of the node.
+		 */
+		int create_node(size_t fileSize, handle handle);
+
+		/**
+		 * All nodes, including recycled ones.
+		 */
+		std::vector<file_size_index_node> m_nodes{};
+
+		/**
+		 * Positions of recycled nodes.
+		 */
+		std::vector<int> m_node_pool{};
+
+		/**
+		 * The position of the root, -1 if empty.
+		 */
+		int m_root = -1;
+
+		/**
+		 * State of the priority generator.
+		 */
+		unsigned int m_seed = 2463534242u;
+	};
+}
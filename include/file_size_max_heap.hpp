@@ -30,18 +30,81 @@ namespace cs251 {
 		 */
 		void push(size_t fileSize, handle handle);
 
+		/**
+		 * \brief Register many new files at once, restoring the heap order bottom-up in O(n).
+		 * \param nodes The files to register. Their handles must not be registered yet.
+		 */
+		void push_all(const std::vector<file_size_max_heap_node>& nodes);
+
 		/**
 		 * \brief Get the handle of the file with maximum size.
 		 * \return The handle of the file.
 		 */
 		handle top() const;
 
+		/**
+		 * \brief Get the handles of the k largest files without modifying the heap, in O(k log k).
+		 * \param k The amount of files.
+		 * \return The handles, largest first. Fewer than k if there are not enough files.
+		 */
+		std::vector<handle> top_k(size_t k) const;
+
 		/**
 		 * \brief Unregister the file by its handle.
 		 * \param handle The handle of the file to be removed.
 		 */
 		void remove(handle handle);
+
+		/**
+		 * \brief Unregister many files at once. Large batches are filtered out and the heap is rebuilt in O(n).
+		 * \param handles The handles to remove. Handles that are not registered are ignored.
+		 */
+		void remove_all(const std::vector<handle>& handles);
+
+		/**
+		 * \brief Change the size of a registered file.
+		 * \param handle The handle of the file.
+		 * \param fileSize The new size of the file.
+		 */
+		void update(handle handle, size_t fileSize);
+
+		/**
+		 * \brief Check if a file is registered.
+		 * \param handle The handle of the file.
+		 * \return Whether the file is in the heap.
+		 */
+		bool contains(handle handle) const;
+
+		/**
+		 * \brief Get the nodes in heap order.
+		 * \return Constant reference to the nodes.
+		 */
+		const std::vector<file_size_max_heap_node>& peek_nodes() const;
 	private:
+		/**
+		 * \brief Move a node up until its parent is not smaller.
+		 * \param index The position of the node.
+		 */
+		void sift_up(size_t index);
+
+		/**
+		 * \brief Move a node down until no child is larger.
+		 * \param index The position of the node.
+		 */
+		void sift_down(size_t index);
+
+		/**
+		 * \brief Swap two nodes and keep their positions up to date.
+		 * \param a The position of the first node.
+		 * \param b The position of the second node.
+		 */
+		void swap_nodes(size_t a, size_t b);
+
+		/**
+		 * \brief Restore the heap order of the whole array bottom-up in O(n).
+		 */
+		void heapify();
+
 		/**
 		 * The amount of nodes of the heap.
 		 */
@@ -51,5 +114,10 @@ namespace cs251 {
 		 * List to store all the nodes.
 		 */
 		std::vector<file_size_max_heap_node> m_nodes{};
+
+		/**
+		 * Position of each file within m_nodes, indexed by handle. -1 if the file is not registered.
+		 */
+		std::vector<int> m_positions{};
 	};
 }
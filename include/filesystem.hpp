@@ -1,12 +1,71 @@
 #pragma once
 #include "tree.hpp"
 #include "file_size_max_heap.hpp"
+#include "file_size_index.hpp"
+#include "operation_log.hpp"
+#include "name_pool.hpp"
+#include "memory"
+#include "ostream"
 namespace cs251 {
 	enum class node_type {
 		Directory,
 		File,
 		Link
 	};
+	struct manifest_entry {
+		/**
+		 * The absolute path of the entry. Its parent directory must appear earlier in the manifest or already exist.
+		 */
+		std::string m_path = {};
+		/**
+		 * The type of the entry.
+		 */
+		node_type m_type = node_type::File;
+		/**
+		 * The size of the entry, only useful when the entry is a file.
+		 */
+		size_t m_fileSize = 0;
+		/**
+		 * The absolute path of the linked target, only useful when the entry is a link.
+		 */
+		std::string m_linkTarget = {};
+	};
+	struct directory_usage {
+		/**
+		 * The total size of the files.
+		 */
+		size_t m_bytes = 0;
+		/**
+		 * The amount of files.
+		 */
+		size_t m_fileCount = 0;
+		/**
+		 * The amount of directories.
+		 */
+		size_t m_directoryCount = 0;
+		/**
+		 * The amount of links.
+		 */
+		size_t m_linkCount = 0;
+	};
+	struct layout_options {
+		/**
+		 * The directory whose contents are printed, or a link to it.
+		 */
+		handle m_root = 0;
+		/**
+		 * The amount of levels printed below the root; its children are the first level.
+		 */
+		size_t m_maxDepth = -1;
+		/**
+		 * The amount of entries to pass over before printing, to continue an earlier, limited dump.
+		 */
+		size_t m_skipEntries = 0;
+		/**
+		 * The most entries printed.
+		 */
+		size_t m_maxEntries = -1;
+	};
 	struct filesystem_node_data {
 		/**
 		 * The type of the node.
@@ -17,13 +76,21 @@ namespace cs251 {
 		 */
 		handle m_linkedHandle = -1;
 		/**
-		 * The name of the node.
+		 * The name of the node, interned in the filesystem's name pool.
 		 */
-		std::string m_name = {};
+		name_id m_name = 0;
 		/**
 		 * The size of the node, only useful when the node is a file.
 		 */
 		size_t m_fileSize = 0;
+		/**
+		 * The aggregate usage of everything below the node, only useful when the node is a directory.
+		 */
+		directory_usage m_usage = {};
+		/**
+		 * The most bytes allowed under the node, only useful when the node is a directory. -1 means no quota.
+		 */
+		size_t m_quota = -1;
 	};
 
 	// Custom exceptions - throw these where appropriate
@@ -33,6 +100,20 @@ namespace cs251 {
 		public: invalid_name() : std::runtime_error("Invalid name!") {} };
 	class exceeds_size : public std::runtime_error {
 		public: exceeds_size() : std::runtime_error("Exceeds file system size limit!") {} };
+	class exceeds_quota : public std::runtime_error {
+		public: exceeds_quota() : std::runtime_error("Exceeds directory quota!") {} };
+	class filesystem_not_empty : public std::runtime_error {
+		public: filesystem_not_empty() : std::runtime_error("Filesystem is not empty!") {} };
+	class invalid_snapshot : public std::runtime_error {
+		public: invalid_snapshot() : std::runtime_error("Invalid snapshot!") {} };
+	class snapshot_io_error : public std::runtime_error {
+		public: snapshot_io_error() : std::runtime_error("Snapshot could not be read or written!") {} };
+	class log_not_open : public std::runtime_error {
+		public: log_not_open() : std::runtime_error("Operation log is not open!") {} };
+	class invalid_log : public std::runtime_error {
+		public: invalid_log() : std::runtime_error("Operation log does not match the snapshot!") {} };
+	class link_cycle : public std::runtime_error {
+		public: link_cycle() : std::runtime_error("Link cycle detected!") {} };
 	class file_exists : public std::runtime_error {
 		public: file_exists() : std::runtime_error("File already exists!") {} };
 	class directory_exists : public std::runtime_error {
@@ -42,9 +123,43 @@ namespace cs251 {
 	class name_exists : public std::runtime_error {
 		public: name_exists() : std::runtime_error("Name already used!") {} };
 
+	struct path_cache_entry {
+		/**
+		 * The absolute path that was resolved.
+		 */
+		std::string m_path = {};
+		/**
+		 * The node the path resolved to, with its generation so a recycled slot is not mistaken for it.
+		 */
+		tagged_handle m_target = {};
+		/**
+		 * The namespace epoch the entry was resolved in. Entries from older epochs are stale.
+		 */
+		unsigned long long m_epoch = 0;
+	};
+	struct link_memo {
+		/**
+		 * The final target the link resolved to, with its generation so a removed target is noticed.
+		 */
+		tagged_handle m_target = {};
+		/**
+		 * The link epoch the target was resolved in. Memos from older epochs are stale.
+		 */
+		unsigned long long m_epoch = 0;
+	};
 	class filesystem {
 	public:
-		explicit filesystem(size_t sizeLimit);
+		/**
+		 * The most links followed in one resolution before it is treated as a cycle.
+		 */
+		static const size_t max_link_hops = 40;
+
+		/**
+		 * \brief Create an empty filesystem.
+		 * \param sizeLimit The total size of all files allowed in the filesystem.
+		 * \param indexChildNames Whether each directory keeps a hashed index of its children's names. Without it, name lookups scan the children.
+		 */
+		explicit filesystem(size_t sizeLimit, bool indexChildNames = true);
 
 		/**
 		 * \brief Create a new file under the root directory.
@@ -76,6 +191,13 @@ namespace cs251 {
 		 */
 		bool remove(handle targetHandle);
 
+		/**
+		 * \brief Delete the target and, if it is a directory, everything below it. Links are not followed.
+		 * \param targetHandle The handle of the target, can be a file, a directory, or a link.
+		 * \return The amount of removed nodes.
+		 */
+		size_t remove_recursive(handle targetHandle);
+
 		/**
 		 * \brief Create a new file under the target directory.
 		 * \param fileSize The size of the file.
@@ -109,6 +231,21 @@ namespace cs251 {
 		 */
 		std::string get_absolute_path(handle targetHandle);
 
+		/**
+		 * \brief Write the absolute path of the target into a buffer, reusing its capacity. Links are not followed.
+		 * The ancestors are walked once and the path is written forward, in at most one allocation.
+		 * \param targetHandle The handle of the target, can be a file, a directory, or a link.
+		 * \param absolutePath The buffer, replaced with the absolute path.
+		 */
+		void get_absolute_path(handle targetHandle, std::string& absolutePath);
+
+		/**
+		 * \brief Turn the memoized parent path on or off. When on, the path of the last parent directory is kept,
+		 * so the paths of its other children are built without walking the ancestors again.
+		 * \param enabled Whether the parent path is memoized.
+		 */
+		void set_parent_path_cache_enabled(bool enabled);
+
 		/**
 		 * \brief Get the name of the target by handle.
 		 * \param targetHandle The handle of the target, can be a file, a link, or a directory.
@@ -116,6 +253,27 @@ namespace cs251 {
 		 */
 		std::string get_name(handle targetHandle);
 
+		/**
+		 * \brief Get the name of the target by handle without copying it.
+		 * \param targetHandle The handle of the target, can be a file, a link, or a directory.
+		 * \return A view of the name, valid as long as the filesystem.
+		 */
+		std::string_view peek_name(handle targetHandle) const;
+
+		/**
+		 * \brief Get the type of the target. Links are not followed.
+		 * \param targetHandle The handle of the target, can be a file, a link, or a directory.
+		 * \return The type of the target.
+		 */
+		node_type get_type(handle targetHandle) const;
+
+		/**
+		 * \brief Get the directory the target is in.
+		 * \param targetHandle The handle of the target, can be a file, a link, or a directory other than the root.
+		 * \return The handle of the parent directory.
+		 */
+		handle get_parent(handle targetHandle) const;
+
 		/**
 		 * \brief Get the size of the file by handle.
 		 * \param targetHandle The handle of the target, can be a file, or a link to the file.
@@ -129,6 +287,48 @@ namespace cs251 {
 		 */
 		size_t get_file_size(const std::string& absolutePath);
 
+		/**
+		 * \brief Change the size of a file.
+		 * \param targetHandle The handle of the target, can be a file, or a link to the file.
+		 * \param newSize The new size of the file.
+		 */
+		void resize_file(handle targetHandle, size_t newSize);
+
+		/**
+		 * \brief Move a target into another directory, keeping its name.
+		 * \param targetHandle The handle of the target, can be a file, a directory, or a link.
+		 * \param parentHandle The new parent directory handle. The handle may also be a link to a directory.
+		 */
+		void move(handle targetHandle, handle parentHandle);
+
+		/**
+		 * \brief Get the total size of the files under a directory in constant time.
+		 * \param targetHandle The handle of the directory, or a link to the directory.
+		 * \return The total size of the files under the directory.
+		 */
+		size_t get_directory_size(handle targetHandle);
+
+		/**
+		 * \brief Get the total size and the file, directory and link counts under a directory in constant time.
+		 * \param targetHandle The handle of the directory, or a link to the directory.
+		 * \return The usage of the directory.
+		 */
+		directory_usage get_directory_usage(handle targetHandle);
+
+		/**
+		 * \brief Limit the total size of the files under a directory. Creates, resizes and moves below it are checked against the quota.
+		 * \param targetHandle The handle of the directory, or a link to the directory.
+		 * \param quota The most bytes allowed under the directory, -1 to remove the quota.
+		 */
+		void set_quota(handle targetHandle, size_t quota);
+
+		/**
+		 * \brief Get the quota of a directory.
+		 * \param targetHandle The handle of the directory, or a link to the directory.
+		 * \return The most bytes allowed under the directory, -1 if there is no quota.
+		 */
+		size_t get_quota(handle targetHandle);
+
 		/**
 		 * \brief Change the name of a target.
 		 * \param targetHandle The handle of the target to be renamed, can be a file, a directory, or a link.
@@ -141,7 +341,21 @@ namespace cs251 {
 		 * \param targetHandle The handle of the target, can be a file, a directory, or a link.
 		 * \return If the target exists.
 		 */
-		bool exist(handle targetHandle);
+		bool exist(handle targetHandle) const;
+
+		/**
+		 * \brief Check if the target still exists and has not been recycled since the tagged handle was taken.
+		 * \param targetHandle The tagged handle of the target, can be a file, a directory, or a link.
+		 * \return If the target exists.
+		 */
+		bool exist(const tagged_handle& targetHandle) const;
+
+		/**
+		 * \brief Pair a handle with its current generation so it can be validated later with exist.
+		 * \param targetHandle The handle of the target, can be a file, a directory, or a link.
+		 * \return The tagged handle.
+		 */
+		tagged_handle get_tagged_handle(handle targetHandle) const;
 
 		/**
 		 * \brief Get the file handle by its absolute path.
@@ -151,24 +365,203 @@ namespace cs251 {
 		handle get_handle(const std::string& absolutePath);
 
 		/**
-		 * \brief Get the handle of the real directory or file, following the links.
+		 * \brief Resolve a path without allocating. Links met before the last component are followed,
+		 * "." stays in the current directory and ".." goes to its parent, staying at the root.
+		 * \param path The path, absolute when it starts with '/' and relative to the start otherwise.
+		 * \param startHandle The directory, or link to one, that relative paths start from.
+		 * \return The handle to the target.
+		 */
+		handle resolve(std::string_view path, handle startHandle = 0);
+
+		/**
+		 * \brief Allocate the node storage for a number of nodes up front, so creating them allocates no node storage.
+		 * Nodes never move as the storage grows either way; reserving only takes the chunk allocations off the create path.
+		 * \param nodeCount The amount of nodes, counting the root.
+		 */
+		void reserve(size_t nodeCount);
+
+		/**
+		 * \brief Choose the order the handles of removed nodes are reused in. The default, Fifo, keeps the numbering
+		 * of earlier versions; Lifo reuses the slots freed last and NearParent the free slot closest to the parent.
+		 * The policy is logged and saved in snapshots, so recovery hands out the same handles as the original run.
+		 * A value outside the enum throws invalid_pool_policy before anything is logged.
+		 * \param policy The policy.
+		 */
+		void set_pool_policy(pool_policy policy);
+
+		/**
+		 * \brief Renumber the nodes into a dense prefix in depth-first order and release the slots of removed nodes,
+		 * which brings back the memory and traversal locality of a tree churned for a long time. Names no live node
+		 * uses any more are released from the name pool. Every handle taken
+		 * before, including the handles in a caller's own tables, must be translated with the returned table.
+		 * When an operation log is open a checkpoint is taken, since the logged operations name the old handles.
+		 * \return The new handle of every old handle, -1 for the handles of removed nodes.
+		 */
+		std::vector<handle> compact();
+
+		/**
+		 * \brief Estimate how far the node storage has drifted from the layout left by compact. Compacting renumbers
+		 * every handle, so it is never done implicitly; callers can compact offline once this crosses a threshold.
+		 * \return The share of node slots that are recycled or were created or moved since the last compact, between 0 and 1.
+		 */
+		double get_fragmentation() const;
+
+		/**
+		 * \brief Set how many absolute paths the lookup cache holds. The cache is direct-mapped, so a cached
+		 * lookup is one hash probe; it is emptied by every rename, move and removal of a directory or link.
+		 * \param entries The amount of entries, rounded up to a power of two. 0 turns the cache off.
+		 */
+		void set_path_cache_capacity(size_t entries);
+
+		/**
+		 * \brief Get the amount of absolute path lookups answered from the cache.
+		 * \return The amount of cache hits.
+		 */
+		size_t get_path_cache_hits() const;
+
+		/**
+		 * \brief Get the amount of absolute path lookups that had to walk the tree while the cache was on.
+		 * \return The amount of cache misses.
+		 */
+		size_t get_path_cache_misses() const;
+
+		/**
+		 * \brief Get the handle of the real directory or file, following the links. Chains longer than max_link_hops,
+		 * which includes every cycle, throw link_cycle. The final target of every link is memoized until a link is
+		 * removed or the target itself is removed.
 		 * \param targetHandle The handle of the target, can be a link to a directory, or a file, or just a file, or just a directory.
 		 * \return The handle of the real directory or file.
 		 */
 		handle follow(handle targetHandle);
 
+		/**
+		 * \brief Resolve a path like resolve, but without the path cache or the link memos. Nothing is written,
+		 * so any number of threads may call it at once as long as no mutation runs at the same time.
+		 * \param path The path, absolute when it starts with '/' and relative to the start otherwise.
+		 * \param startHandle The directory, or link to one, that relative paths start from.
+		 * \return The handle to the target.
+		 */
+		handle peek_handle(std::string_view path, handle startHandle = 0) const;
+
+		/**
+		 * \brief Follow the links like follow, walking every hop instead of using the memos. Safe to call from many threads at once.
+		 * \param targetHandle The handle of the target, can be a link to a directory, or a file, or just a file, or just a directory.
+		 * \return The handle of the real directory or file.
+		 */
+		handle peek_follow(handle targetHandle) const;
+
+		/**
+		 * \brief Get the size of the file like get_file_size, without writing anything. Safe to call from many threads at once.
+		 * \param targetHandle The handle of the target, can be a file, or a link to the file.
+		 * \return The size of the target file.
+		 */
+		size_t peek_file_size(handle targetHandle) const;
+
+		/**
+		 * \brief Get the links that point directly at a node. When a node is removed, these links are left dangling
+		 * instead of following its handle to whatever node recycles it.
+		 * \param targetHandle The handle of the target, can be a file, a directory, or a link.
+		 * \return The handles of the links.
+		 */
+		std::vector<handle> get_links_to(handle targetHandle);
+
 		/**
 		 * \brief Get the layout of the file hierarchies.
 		 * \return The layout as string.
 		 */
 		std::string print_layout();
 
+		/**
+		 * \brief Stream the layout of a part of the file hierarchies, one line per entry, in the same format as print_layout.
+		 * The traversal walks the sibling lists without recursion, so memory stays bounded by the depth of the tree.
+		 * Right after compact, and until the next structural change, it is a linear sweep over the storage instead.
+		 * \param out The stream to write to.
+		 * \param options The subtree, the depth and the range of entries to print.
+		 * \return The amount of entries written.
+		 */
+		size_t print_layout(std::ostream& out, const layout_options& options);
+
+		/**
+		 * \brief Populate an empty filesystem from a manifest in one pass, building the heap bottom-up.
+		 * Nothing is created if the manifest is invalid, including when its links form a cycle. With a log open a
+		 * checkpoint is taken either way, since the rollback changes which handles are reused next.
+		 * \param entries The entries, sorted so every directory comes before its contents.
+		 */
+		void load_manifest(const std::vector<manifest_entry>& entries);
+
+		/**
+		 * \brief Write the whole filesystem, including recycled handles and the heap, to a versioned binary snapshot.
+		 * The file is written next to the target and renamed over it, so a crash never leaves a partial snapshot,
+		 * and the directory is synced after the rename so the new snapshot is durable when this returns.
+		 * \param path The path of the snapshot file.
+		 */
+		void save_snapshot(const std::string& path) const;
+
+		/**
+		 * \brief Replace the contents of the filesystem with a snapshot. The file is memory-mapped and its fixed-size
+		 * records are copied into place, so handles, generations, the pool and its policy are exactly as they were saved.
+		 * Records that break an invariant the create paths keep, such as a bad name, two siblings with one name or a
+		 * handle pooled twice, make the snapshot invalid.
+		 * \param path The path of the snapshot file.
+		 */
+		void load_snapshot(const std::string& path);
+
+		/**
+		 * \brief Recover from a checkpoint and an operation log, then keep logging every mutation to it.
+		 * The snapshot is loaded when it exists, and the logged operations newer than it are replayed, so recovery
+		 * only redoes the work since the last checkpoint. Mutations are made durable a group at a time; up to
+		 * groupSize - 1 of the latest ones are lost on a crash unless sync_log is called.
+		 * \param logPath The path of the operation log.
+		 * \param snapshotPath The path of the snapshot written by checkpoints.
+		 * \param groupSize The amount of mutations that share one flush of the log.
+		 * \param checkpointInterval The amount of logged mutations after which a checkpoint is taken, 0 for never.
+		 */
+		void open_log(const std::string& logPath, const std::string& snapshotPath, size_t groupSize = 64, size_t checkpointInterval = 0);
+
+		/**
+		 * \brief Flush the mutations that are waiting for their group to fill up.
+		 */
+		void sync_log();
+
+		/**
+		 * \brief Save a snapshot and empty the operation log, which bounds the work of the next recovery.
+		 */
+		void checkpoint();
+
+		/**
+		 * \brief Flush and stop using the operation log.
+		 */
+		void close_log();
+
 		/**
 		 * \brief Get the handle of the largest file.
 		 * \return The handle to the largest file.
 		 */
 		handle get_largest_file_handle() const;
 
+		/**
+		 * \brief Get the handles of the largest files.
+		 * \param k The amount of files.
+		 * \return The handles, largest first. Fewer than k if there are not enough files.
+		 */
+		std::vector<handle> get_largest_files(size_t k) const;
+
+		/**
+		 * \brief Count the files whose size is within a range.
+		 * \param minSize The lower bound, inclusive.
+		 * \param maxSize The upper bound, inclusive.
+		 * \return The amount of files in the range.
+		 */
+		size_t count_files_in_range(size_t minSize, size_t maxSize) const;
+
+		/**
+		 * \brief Get the total size of the files whose size is within a range.
+		 * \param minSize The lower bound, inclusive.
+		 * \param maxSize The upper bound, inclusive.
+		 * \return The total size of the files in the range.
+		 */
+		size_t get_bytes_in_range(size_t minSize, size_t maxSize) const;
+
 		/**
 		 * \brief Get the available size of the file system.
 		 * \return The available size of the file.
@@ -179,6 +572,10 @@ namespace cs251 {
          * The max heap for the file sizes
          */
         file_size_max_heap m_maxHeap;
+        /**
+         * Order statistics over the file sizes, for range queries.
+         */
+        file_size_index m_sizeIndex;
 		/**
 		 * The size limit of the filesystem.
 		 */
@@ -187,8 +584,170 @@ namespace cs251 {
 		 * The current size of the filesystem.
 		 */
         size_t m_currentSize = 0;
+		/**
+		 * The amount of directories with a quota, so the quota check can be skipped when there are none.
+		 */
+        size_t m_quotaCount = 0;
             
-		void print_traverse(size_t level, std::stringstream& ss, handle targetHandle);
+		/**
+		 * \brief Write the line of one entry of the layout.
+		 * \param out The stream to write to.
+		 * \param indentation The tabs in front of the entry.
+		 * \param targetHandle The handle of the entry.
+		 * \param linkPath A buffer for the path of linked targets, reused between entries.
+		 */
+		void print_entry(std::ostream& out, const std::string& indentation, handle targetHandle, std::string& linkPath);
+		/**
+		 * \brief Get what a node adds to the usage of the directories above it.
+		 * \param targetHandle The handle of the node.
+		 * \return The usage of the node itself and everything below it.
+		 */
+		directory_usage get_contribution(handle targetHandle);
+		/**
+		 * \brief Check that a name can be given to an entry: not empty, not "." or "..", and without a slash.
+		 * \param name The name.
+		 */
+		static void check_name(std::string_view name);
+		/**
+		 * \brief Add or subtract a usage on a directory and all of its ancestors.
+		 * \param directoryHandle The handle of the lowest directory to update.
+		 * \param usage The usage to apply.
+		 * \param add Whether to add or subtract the usage.
+		 */
+		void propagate_usage(handle directoryHandle, const directory_usage& usage, bool add);
+		/**
+		 * \brief Check that adding bytes under a directory stays within the quota of it and all of its ancestors.
+		 * \param directoryHandle The handle of the lowest directory that grows.
+		 * \param bytes The amount of bytes added.
+		 * \param stopHandle The ancestor at which to stop checking, -1 to check up to the root.
+		 */
+		void check_quota(handle directoryHandle, size_t bytes, handle stopHandle = -1);
+		/**
+		 * \brief Append a mutation to the operation log when one is open, and checkpoint when the interval is reached.
+		 * \param type The type of the mutation.
+		 * \param targetHandle The node it works on, or the parent for the creates.
+		 * \param otherHandle The target of a link or the new parent of a move, -1 otherwise.
+		 * \param value The file size or quota, 0 otherwise.
+		 * \param name The name of a create or rename, empty otherwise.
+		 */
+		void log_operation(operation_type type, handle targetHandle, handle otherHandle = -1, size_t value = 0, const std::string& name = {});
+		/**
+		 * \brief Walk the tree to resolve a path, the uncached part of resolve.
+		 * \param path The path.
+		 * \param startHandle The directory, or link to one, that relative paths start from.
+		 * \return The handle to the target.
+		 */
+		handle resolve_uncached(std::string_view path, handle startHandle);
+		/**
+		 * \brief Walk the tree to resolve a path, shared by resolve_uncached and peek_handle.
+		 * \param path The path.
+		 * \param startHandle The directory, or link to one, that relative paths start from.
+		 * \param followLink Gets the real directory or file behind a handle.
+		 * \return The handle to the target.
+		 */
+		template <typename follow_function>
+		handle walk_path(std::string_view path, handle startHandle, follow_function followLink) const;
+		/**
+		 * \brief Make every cached path stale, after a change that can alter what existing paths resolve to.
+		 */
+		void invalidate_paths();
+		/**
+		 * \brief Make every memoized link target stale, after a link is removed and may be recycled.
+		 */
+		void invalidate_links();
+		/**
+		 * \brief Record a link in the reverse link index.
+		 * \param linkHandle The handle of the link.
+		 * \param targetHandle The handle the link points at.
+		 */
+		void register_link(handle linkHandle, handle targetHandle);
+		/**
+		 * \brief Drop a link from the reverse link index, before or after the link itself is removed.
+		 * \param linkHandle The handle of the link.
+		 */
+		void unregister_link(handle linkHandle);
+		/**
+		 * \brief Leave the live links to a removed node dangling, and forget them in the reverse link index.
+		 * \param targetHandle The handle of the removed node.
+		 */
+		void detach_links(handle targetHandle);
+		/**
+		 * \brief Apply a logged mutation again.
+		 * \param record The mutation.
+		 */
+		void replay_operation(const operation_record& record);
+		/**
+		 * The interned names of the nodes. Held by pointer so the tree's child key can refer to it across moves.
+		 */
+		std::unique_ptr<name_pool> m_names = std::make_unique<name_pool>();
+		/**
+		 * The direct-mapped path lookup cache, empty when it is off.
+		 */
+		std::vector<path_cache_entry> m_pathCache = std::vector<path_cache_entry>(1024);
+		/**
+		 * The current namespace epoch, bumped by invalidate_paths.
+		 */
+		unsigned long long m_pathEpoch = 1;
+		/**
+		 * The amount of lookups answered from the path cache.
+		 */
+		size_t m_pathCacheHits = 0;
+		/**
+		 * The amount of lookups that missed the path cache.
+		 */
+		size_t m_pathCacheMisses = 0;
+		/**
+		 * The links pointing directly at each node, for the nodes that have any.
+		 */
+		std::unordered_map<handle, std::vector<handle>> m_linksTo = {};
+		/**
+		 * The memoized final targets of the links, by link handle.
+		 */
+		std::vector<link_memo> m_linkMemos = {};
+		/**
+		 * The current link epoch, bumped by invalidate_links.
+		 */
+		unsigned long long m_linkEpoch = 1;
+		/**
+		 * Whether the path of the last parent directory is memoized by get_absolute_path.
+		 */
+		bool m_parentPathCacheEnabled = true;
+		/**
+		 * The directory whose path is memoized.
+		 */
+		tagged_handle m_parentPathHandle = {};
+		/**
+		 * The namespace epoch the memoized path was built in.
+		 */
+		unsigned long long m_parentPathEpoch = 0;
+		/**
+		 * The memoized path of the directory.
+		 */
+		std::string m_parentPath = {};
+		/**
+		 * The ancestors of the node whose path is being built, reused between calls.
+		 */
+		std::vector<handle> m_pathScratch = {};
+		/**
+		 * The operation log, null when mutations are not logged.
+		 */
+		std::unique_ptr<operation_log> m_log{};
+		/**
+		 * The path checkpoints are written to.
+		 */
+		std::string m_snapshotPath{};
+		/**
+		 * The sequence number of the last logged mutation, also stored in snapshots.
+		 */
+		unsigned long long m_logSequence = 0;
+		/**
+		 * The amount of logged mutations between automatic checkpoints, 0 for none.
+		 */
+		size_t m_checkpointInterval = 0;
+		/**
+		 * The amount of mutations logged since the last checkpoint.
+		 */
+		size_t m_operationsSinceCheckpoint = 0;
 		/**
 		 * The tree instance that hold the filesystem's data.
 		 */
@@ -0,0 +1,75 @@
+#pragma once
+#include "memory"
+#include "string_view"
+#include "unordered_map"
+#include "vector"
+
+namespace cs251 {
+	typedef unsigned int name_id;
+
+	/**
+	 * Append-only arena of interned names. Every distinct name is stored once and referred to by a small id,
+	 * and the views handed out stay valid for the lifetime of the pool because stored bytes never move.
+	 * Names are never released one by one; the filesystem reclaims them by interning its live names into a new pool.
+	 */
+	class name_pool {
+	public:
+		/**
+		 * The id returned by find for names that were never interned.
+		 */
+		static const name_id npos = static_cast<name_id>(-1);
+
+		/**
+		 * \brief Create a pool holding only the empty name, with id 0.
+		 */
+		name_pool();
+
+		/**
+		 * \brief Get the id of a name, storing the name if it is new.
+		 * \param name The name.
+		 * \return The id of the name.
+		 */
+		name_id intern(std::string_view name);
+
+		/**
+		 * \brief Get the id of a name without storing it.
+		 * \param name The name.
+		 * \return The id of the name, or npos if it was never interned.
+		 */
+		name_id find(std::string_view name) const;
+
+		/**
+		 * \brief Get the characters of an interned name.
+		 * \param id The id of the name.
+		 * \return A view of the name that stays valid as long as the pool.
+		 */
+		std::string_view view(name_id id) const;
+
+		/**
+		 * \brief Get the amount of distinct names.
+		 * \return The amount of names.
+		 */
+		size_t size() const;
+	private:
+		/**
+		 * The size of the blocks names are copied into; longer names get a block of their own.
+		 */
+		static const size_t block_size = 64 * 1024;
+		/**
+		 * The blocks holding the characters of the names.
+		 */
+		std::vector<std::unique_ptr<char[]>> m_blocks {};
+		/**
+		 * The amount of bytes used in the last block.
+		 */
+		size_t m_blockUsed = block_size;
+		/**
+		 * The names by id.
+		 */
+		std::vector<std::string_view> m_names {};
+		/**
+		 * The ids by name, keyed by views into the blocks.
+		 */
+		std::unordered_map<std::string_view, name_id> m_ids {};
+	};
+}
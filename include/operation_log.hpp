@@ -0,0 +1,116 @@
+#pragma once
+#include "string"
+#include "vector"
+#include "stdexcept"
+#include "tree.hpp"
+
+namespace cs251 {
+	enum class operation_type {
+		CreateFile,
+		CreateDirectory,
+		CreateLink,
+		Remove,
+		RemoveRecursive,
+		Rename,
+		Move,
+		ResizeFile,
+		SetQuota,
+		SetPoolPolicy
+	};
+	struct operation_record {
+		/**
+		 * The sequence number of the operation, increasing by one for every logged operation.
+		 */
+		unsigned long long m_sequence = 0;
+		/**
+		 * The type of the operation.
+		 */
+		operation_type m_type = operation_type::CreateFile;
+		/**
+		 * The node the operation works on, or the parent for the creates.
+		 */
+		handle m_handle = -1;
+		/**
+		 * The target of a link, or the new parent of a move.
+		 */
+		handle m_target = -1;
+		/**
+		 * The file size of a create or resize, the quota, or the pool policy.
+		 */
+		size_t m_value = 0;
+		/**
+		 * The name of a create or rename.
+		 */
+		std::string m_name = {};
+	};
+
+	class log_io_error : public std::runtime_error {
+		public: log_io_error() : std::runtime_error("Operation log could not be read or written!") {} };
+
+	/**
+	 * Append-only binary log of filesystem mutations. Appended records are buffered and written with a single
+	 * fsync once a group of them is pending, so many operations share the cost of one flush.
+	 * Every record carries its length and a checksum; a torn record at the end, left by a crash in the middle
+	 * of a write, is dropped when the log is read back.
+	 */
+	class operation_log {
+	public:
+		/**
+		 * \brief Open a log, creating the file when it does not exist. Records already in it are kept.
+		 * \param path The path of the log file.
+		 * \param groupSize The amount of records to collect before they are written and flushed together.
+		 */
+		operation_log(const std::string& path, size_t groupSize);
+		/**
+		 * \brief Commit the pending records and close the file.
+		 */
+		~operation_log();
+		operation_log(const operation_log&) = delete;
+		operation_log& operator=(const operation_log&) = delete;
+
+		/**
+		 * \brief Read every complete record in the file and cut off a torn tail, so appends continue after it.
+		 * \return The records in the order they were appended.
+		 */
+		std::vector<operation_record> read_records();
+
+		/**
+		 * \brief Add a record, committing the group when it is full.
+		 * \param record The record.
+		 */
+		void append(const operation_record& record);
+
+		/**
+		 * \brief Write the pending records and wait until they are on disk.
+		 */
+		void commit();
+
+		/**
+		 * \brief Drop every record, pending or on disk. Used once a checkpoint holds all of them.
+		 */
+		void truncate();
+
+		/**
+		 * \brief Get the amount of records that are appended but not committed yet.
+		 * \return The amount of pending records.
+		 */
+		size_t get_pending_count() const;
+	private:
+		/**
+		 * The file descriptor of the log file.
+		 */
+		int m_fd = -1;
+		/**
+		 * The encoded records waiting for the next commit.
+		 */
+		std::string m_buffer = {};
+		/**
+		 * The amount of records in the buffer.
+		 */
+		size_t m_pendingCount = 0;
+		/**
+		 * The amount of records committed together.
+		 */
+		size_t m_groupSize = 1;
+	};
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include "concurrent_filesystem.hpp"
+#include "atomic"
+
+namespace cs251 {
+	/**
+	 * A filesystem split by top-level entry into partitions that lock independently, so mutations in different
+	 * top-level directories run in parallel. Every partition is a concurrent_filesystem holding a few of the
+	 * top-level entries; below the root each subtree lives entirely in one partition. So only top-level entries spread
+	 * the work: creates in sibling subdirectories of one top-level directory take the same partition lock and run
+	 * one at a time.
+	 * The size limit is shared through an atomic counter that creates and resizes reserve from before they run,
+	 * and the largest file is the largest of the partitions' heaps.
+	 * Links can point anywhere: the partition of a link only holds its name, and the target is kept in a link table
+	 * shared by the partitions, so paths resolve across partitions like in one filesystem. Moves must stay inside one
+	 * partition or go to the root.
+	 * Directory quotas are not supported: there is no set_quota, and no quota is checked.
+	 */
+	class partitioned_filesystem {
+	public:
+		/**
+		 * \brief Create a partitioned filesystem.
+		 * \param sizeLimit The size limit of the filesystem.
+		 * \param partitionCount The amount of partitions, the most mutations that can run at once.
+		 */
+		explicit partitioned_filesystem(size_t sizeLimit, size_t partitionCount = 16);
+
+		/**
+		 * \brief Create a file under a directory. Top-level entries are spread over the partitions in turn.
+		 * \param fileSize The size of the file.
+		 * \param fileName The name of the file.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \return The handle of the file.
+		 */
+		handle create_file(size_t fileSize, const std::string& fileName, handle parentHandle = 0);
+
+		/**
+		 * \brief Create a directory under a directory.
+		 * \param directoryName The name of the directory.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \return The handle of the directory.
+		 */
+		handle create_directory(const std::string& directoryName, handle parentHandle = 0);
+
+		/**
+		 * \brief Create a link under a directory. A top-level link is placed in the partition of its target.
+		 * \param targetHandle The handle of the linked target, in any partition.
+		 * \param linkName The name of the link.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \return The handle of the link.
+		 */
+		handle create_link(handle targetHandle, const std::string& linkName, handle parentHandle = 0);
+
+		/**
+		 * \brief Delete the file, link or empty directory.
+		 * \param targetHandle The handle of the target.
+		 * \return If the target is removed.
+		 */
+		bool remove(handle targetHandle);
+
+		/**
+		 * \brief Delete the target and everything below it.
+		 * \param targetHandle The handle of the target.
+		 * \return The amount of removed nodes.
+		 */
+		size_t remove_recursive(handle targetHandle);
+
+		/**
+		 * \brief Change the size of a file.
+		 * \param targetHandle The handle of the file, or a link to it.
+		 * \param newSize The new size of the file.
+		 */
+		void resize_file(handle targetHandle, size_t newSize);
+
+		/**
+		 * \brief Rename the target.
+		 * \param targetHandle The handle of the target.
+		 * \param newName The new name.
+		 */
+		void rename(handle targetHandle, const std::string& newName);
+
+		/**
+		 * \brief Move the target under another directory of the same partition, or to the root.
+		 * \param targetHandle The handle of the target.
+		 * \param parentHandle The handle of the new parent directory, or a link to it.
+		 */
+		void move(handle targetHandle, handle parentHandle);
+
+		/**
+		 * \brief Resolve an absolute path, following links and ".." into whichever partition they lead to.
+		 * \param path The absolute path of the target.
+		 * \return The handle to the target.
+		 */
+		handle get_handle(std::string_view path) const;
+
+		/**
+		 * \brief Get the handle of the real directory or file, following links across partitions.
+		 * \param targetHandle The handle of the target.
+		 * \return The handle of the target itself when it is not a link, otherwise of what the links lead to.
+		 */
+		handle follow(handle targetHandle) const;
+
+		/**
+		 * \brief Check if the target exists.
+		 * \param targetHandle The handle of the target.
+		 * \return If the target exists.
+		 */
+		bool exist(handle targetHandle) const;
+
+		/**
+		 * \brief Get the name of the target.
+		 * \param targetHandle The handle of the target.
+		 * \return The name of the target.
+		 */
+		std::string get_name(handle targetHandle) const;
+
+		/**
+		 * \brief Get the size of the file by handle.
+		 * \param targetHandle The handle of the file, or a link to it.
+		 * \return The size of the file.
+		 */
+		size_t get_file_size(handle targetHandle) const;
+
+		/**
+		 * \brief Get the largest file of all the partitions.
+		 * \return The handle of the largest file.
+		 */
+		handle get_largest_file_handle() const;
+
+		/**
+		 * \brief Get the remaining size.
+		 * \return The size limit minus the reserved size.
+		 */
+		size_t get_available_size() const;
+	private:
+		/**
+		 * \brief Split a handle into its partition and the handle inside the partition.
+		 * \param targetHandle The handle.
+		 * \param partition Set to the partition, 0 for the root.
+		 * \return The handle inside the partition.
+		 */
+		handle to_local(handle targetHandle, size_t& partition) const;
+		/**
+		 * \brief Combine a partition and a handle inside it into one handle.
+		 * \param partition The partition.
+		 * \param localHandle The handle inside the partition.
+		 * \return The handle, 0 for the root of any partition.
+		 */
+		handle to_global(size_t partition, handle localHandle) const;
+		/**
+		 * \brief Follow the links from a handle, taking one partition's lock at a time.
+		 * \param targetHandle The handle of the target.
+		 * \param type Set to the type of the node the links lead to.
+		 * \return The handle of the node the links lead to.
+		 */
+		handle follow(handle targetHandle, node_type& type) const;
+		/**
+		 * \brief Create an entry in the partition of its parent, claiming its name first when it goes to the root.
+		 * \param parentHandle The handle of the parent directory, or a link to it.
+		 * \param name The name of the entry.
+		 * \param type The type of the entry, which picks the exception when a top-level name is taken.
+		 * \param rootPartition The partition a top-level entry goes to, or -1 to pick the next one in turn.
+		 * \param create Creates the entry, called under the partition's lock with the partition's filesystem, its index
+		 * and the parent inside it.
+		 * \return The handle of the entry.
+		 */
+		template <typename function>
+		handle create_entry(handle parentHandle, const std::string& name, node_type type, size_t rootPartition, function create);
+		/**
+		 * \brief Take bytes from the shared size limit.
+		 * \param bytes The amount of bytes.
+		 */
+		void reserve_size(size_t bytes);
+		/**
+		 * \brief Return bytes to the shared size limit.
+		 * \param bytes The amount of bytes.
+		 */
+		void release_size(size_t bytes);
+		/**
+		 * \brief Take a top-level name, before the entry is made in its partition.
+		 * \param name The name.
+		 * \param partition The partition of the entry, or -1 to pick the next partition in turn.
+		 * \return The partition of the entry.
+		 */
+		size_t claim_root_name(const std::string& name, size_t partition);
+		/**
+		 * \brief Give up a top-level name, after the entry left the root or was never made.
+		 * \param name The name.
+		 */
+		void release_root_name(const std::string& name);
+		/**
+		 * The partitions.
+		 */
+		std::vector<std::unique_ptr<concurrent_filesystem>> m_partitions {};
+		/**
+		 * The size limit of the filesystem.
+		 */
+		size_t m_sizeLimit = -1;
+		/**
+		 * The size reserved by the files of every partition.
+		 */
+		std::atomic<size_t> m_currentSize {0};
+		/**
+		 * Guards the top-level names. Never held while waiting for a partition.
+		 */
+		mutable std::shared_mutex m_rootMutex;
+		/**
+		 * The top-level names, keyed by views into m_rootNamePool.
+		 */
+		std::unordered_map<std::string_view, size_t> m_rootPartitions {};
+		/**
+		 * Stores the top-level names for the views in m_rootPartitions.
+		 */
+		name_pool m_rootNamePool {};
+		/**
+		 * The partition the next top-level entry goes to.
+		 */
+		size_t m_nextPartition = 0;
+		/**
+		 * Guards the link table. Taken inside a partition's lock and never held while waiting for a partition.
+		 */
+		mutable std::shared_mutex m_linkMutex;
+		/**
+		 * The target of every link by the link's handle, tagged with the target's generation in its partition.
+		 */
+		std::unordered_map<handle, tagged_handle> m_linkTargets {};
+	};
+}
@@ -1,10 +1,18 @@
 #pragma once
+#include "algorithm"
+#include "cassert"
 #include "cstring"
 #include "sstream"
 #include "string"
+#include "string_view"
 #include "exception"
 #include "vector"
-#include "queue"
+#include "deque"
+#include "set"
+#include "functional"
+#include "iterator"
+#include "unordered_map"
+#include "chunked_vector.hpp"
 
 namespace cs251 {
 	typedef int handle;
@@ -13,6 +21,36 @@ namespace cs251 {
 		public: invalid_handle() : std::runtime_error("Invalid handle!") {} };
 	class recycled_node : public std::runtime_error {
 		public: recycled_node() : std::runtime_error("Node is recycled!") {} };
+	class child_key_unset : public std::runtime_error {
+		public: child_key_unset() : std::runtime_error("Child key is not set!") {} };
+	class invalid_pool_policy : public std::runtime_error {
+		public: invalid_pool_policy() : std::runtime_error("Invalid pool policy!") {} };
+
+	/**
+	 * The order recycled handles are handed out in. Fifo reuses the slot freed longest ago, Lifo the one freed last,
+	 * whose memory is most likely still in cache, and NearParent the free slot closest to the new node's parent.
+	 */
+	enum class pool_policy {
+		Fifo,
+		Lifo,
+		NearParent
+	};
+
+	/**
+	 * A handle paired with the generation of the node it was taken from.
+	 * Recycling a node bumps its generation, so a tagged handle kept across a
+	 * remove is detected as stale even after the slot is reused from the pool.
+	 */
+	struct tagged_handle {
+		/**
+		 * The handle of the node.
+		 */
+		handle m_handle = -1;
+		/**
+		 * The generation of the node when the handle was taken.
+		 */
+		unsigned int m_generation = 0;
+	};
 
 	template<typename tree_node_data>
 	class tree_node {
@@ -24,6 +62,10 @@ namespace cs251 {
 		 * The handle of current node, should be the index of current node within the vector array in tree.
 		 */
 		handle m_handle = -1;
+		/**
+		 * How many times the node has been recycled.
+		 */
+		unsigned int m_generation = 0;
 		/**
 		 * Whether the node is recycled.
 		 */
@@ -37,9 +79,29 @@ namespace cs251 {
 		 */
 		handle m_parentHandle = -1;
 		/**
-		 * List of handles to all children.
+		 * The handle of the first child, -1 if there are no children.
 		 */
-		std::vector<handle> m_childrenHandles{};
+		handle m_firstChildHandle = -1;
+		/**
+		 * The handle of the last child, -1 if there are no children.
+		 */
+		handle m_lastChildHandle = -1;
+		/**
+		 * The handle of the previous sibling, -1 for the first child.
+		 */
+		handle m_prevSiblingHandle = -1;
+		/**
+		 * The handle of the next sibling, -1 for the last child.
+		 */
+		handle m_nextSiblingHandle = -1;
+		/**
+		 * The amount of children.
+		 */
+		size_t m_childCount = 0;
+		/**
+		 * Map from child key to child handle, only filled when the tree's child index is enabled.
+		 */
+		std::unordered_map<std::string_view, handle> m_childIndex{};
 
 	public:
 		/**
@@ -47,6 +109,11 @@ namespace cs251 {
 		 * \return The modifiable reference to the node's data.
 		 */
 		tree_node_data& ref_data();
+		/**
+		 * \brief Read the data for this node. A recycled node keeps the data it was removed with until it is reused.
+		 * \return The constant reference to the node's data.
+		 */
+		const tree_node_data& peek_data() const;
 		/**
 		 * \brief Check if the node is recycled.
 		 * \return Whether this node is recycled or not.
@@ -57,20 +124,96 @@ namespace cs251 {
 		 * \return The handle of this node.
 		 */
 		handle get_handle() const;
+		/**
+		 * \brief Get the generation of this node.
+		 * \return How many times this node has been recycled.
+		 */
+		unsigned int get_generation() const;
 		/**
 		 * \brief Get the handle of this node's parent.
 		 * \return The handle of this node's parent.
 		 */
 		handle get_parent_handle() const;
 		/**
-		 * \brief Get the list of handles of this node's children.
-		 * \return The list of handles of this node's children.
+		 * \brief Get the handle of this node's first child.
+		 * \return The handle of the first child, -1 if there are no children.
 		 */
-		const std::vector<handle>& peek_children_handles() const;
+		handle get_first_child_handle() const;
+		/**
+		 * \brief Get the handle of this node's next sibling.
+		 * \return The handle of the next sibling, -1 if this is the last child.
+		 */
+		handle get_next_sibling_handle() const;
+		/**
+		 * \brief Get the amount of this node's children.
+		 * \return The amount of children.
+		 */
+		size_t get_child_count() const;
 	};
 
+	template<typename tree_node_data>
+	class tree;
+
+	/**
+	 * Iterates the children of a node by following the sibling handles stored in the nodes.
+	 */
+	template<typename tree_node_data>
+	class child_iterator {
+	public:
+		child_iterator(const tree<tree_node_data>* owner, handle h) : m_tree(owner), m_handle(h) {}
+		handle operator*() const { return m_handle; }
+		child_iterator& operator++() {
+			m_handle = m_tree->m_nodes[m_handle].get_next_sibling_handle();
+			return *this;
+		}
+		bool operator==(const child_iterator& other) const { return m_handle == other.m_handle; }
+		bool operator!=(const child_iterator& other) const { return m_handle != other.m_handle; }
+	private:
+		/**
+		 * The tree that owns the nodes.
+		 */
+		const tree<tree_node_data>* m_tree;
+		/**
+		 * The handle of the current child, -1 past the last child.
+		 */
+		handle m_handle;
+	};
+
+	/**
+	 * The children of a node, usable in range-based for loops.
+	 */
+	template<typename tree_node_data>
+	class child_range {
+	public:
+		child_range(const tree<tree_node_data>* owner, handle firstChild, size_t count) : m_tree(owner), m_firstChild(firstChild), m_count(count) {}
+		child_iterator<tree_node_data> begin() const { return child_iterator<tree_node_data>(m_tree, m_firstChild); }
+		child_iterator<tree_node_data> end() const { return child_iterator<tree_node_data>(m_tree, -1); }
+		bool empty() const { return m_count == 0; }
+		size_t size() const { return m_count; }
+	private:
+		/**
+		 * The tree that owns the nodes.
+		 */
+		const tree<tree_node_data>* m_tree;
+		/**
+		 * The handle of the first child.
+		 */
+		handle m_firstChild;
+		/**
+		 * The amount of children.
+		 */
+		size_t m_count;
+	};
+
+	/**
+	 * A tree of nodes addressed by handles, with recycled handles reused from a pool. Each node owns its parent,
+	 * liveness and generation; m_parents, m_alive and m_generations are a read-side cache of those fields in dense
+	 * arrays, so lookups and ancestor walks do not touch whole nodes. The cache is written only by sync_dense after
+	 * a node changes, and debug builds check it against the nodes whenever it is read.
+	 */
 	template<typename tree_node_data>
 	class tree {
+		friend class child_iterator<tree_node_data>;
 	public:
 		/**
 		 * \brief The constructor of the tree class. You should allocate the root node here.
@@ -81,38 +224,251 @@ namespace cs251 {
 		 * \return The handle of the new node.
 		 */
 		handle allocate(handle parentHandle);
+		/**
+		 * \brief Allocate a new node with its data already set, so it is indexed under its key.
+		 * \param parentHandle The handle of the parent node.
+		 * \param data The content of the new node.
+		 * \return The handle of the new node.
+		 */
+		handle allocate(handle parentHandle, const tree_node_data& data);
 		/**
 		 * \brief Remove (recycle) a node. Remove all descendent nodes.
+		 * Runs iteratively in O(subtree size) and returns the freed handles to the pool in one batch.
 		 * \param handle The handle of the target node to be removed.
+		 * \return The freed handles, descendants before their parents and the target last.
 		 */
-		void remove(handle handle);
+		std::vector<handle> remove(handle handle);
 		/**
 		 * \brief Attach a node to another node as its child.
 		 * \param targetHandle The handle of the target node as child.
 		 * \param parentHandle The handle of the parent node.
 		 */
 		void set_parent(handle targetHandle, handle parentHandle);
+		/**
+		 * \brief Allocate the storage for a number of nodes up front, so growing to it allocates nothing.
+		 * \param count The amount of nodes, including the root and the recycled ones.
+		 */
+		void reserve(size_t count);
 		/**
 		 * \brief Return the constant reference to the list of nodes.
 		 * \return Constant reference to the list of nodes.
 		 */
-		const std::vector<tree_node<tree_node_data>>& peek_nodes() const;
+		const chunked_vector<tree_node<tree_node_data>>& peek_nodes() const;
 		/**
 		 * \brief Retrieve the node with its handle.
 		 * \param handle The handle of the target node.
 		 * \return The reference to the node.
 		 */
 		tree_node<tree_node_data>& ref_node(handle handle);
+		/**
+		 * \brief Get the children of a node, in the order they were attached.
+		 * \param handle The handle of the parent node.
+		 * \return The range of child handles.
+		 */
+		child_range<tree_node_data> peek_children(handle handle) const;
+		/**
+		 * \brief Check in constant time if a handle refers to an allocated node.
+		 * \param handle The handle of the target node.
+		 * \return Whether the handle is in range and the node is not recycled.
+		 */
+		bool is_alive(handle handle) const;
+		/**
+		 * \brief Check in constant time if a tagged handle still refers to the node it was taken from.
+		 * \param taggedHandle The tagged handle of the target node.
+		 * \return Whether the node is allocated and has not been recycled since the handle was taken.
+		 */
+		bool is_alive(const tagged_handle& taggedHandle) const;
+		/**
+		 * \brief Pair a handle with the current generation of its node.
+		 * \param handle The handle of the target node.
+		 * \return The tagged handle.
+		 */
+		tagged_handle get_tagged_handle(handle handle) const;
+		/**
+		 * \brief Get the parent of a node from the dense parent array, without touching the node itself.
+		 * \param handle The handle of the target node.
+		 * \return The handle of the parent node, -1 for the root.
+		 */
+		handle get_parent(handle handle) const;
+		/**
+		 * \brief Count the ancestors of a node by walking the dense parent array.
+		 * \param handle The handle of the target node.
+		 * \return The amount of ancestors, 0 for the root.
+		 */
+		size_t get_depth(handle handle) const;
+		/**
+		 * \brief Set the function that gives the key of a node, used to look children up by key.
+		 * \param keyFunction Returns the key of a node from its data. Keys are expected to be unique among siblings,
+		 * and the characters they view must stay in place while the node is in the tree.
+		 */
+		void set_child_key(std::function<std::string_view(const tree_node_data&)> keyFunction);
+		/**
+		 * \brief Turn the per-node child index on or off. Turning it on indexes every existing node.
+		 * \param enabled Whether children should be indexed by key.
+		 */
+		void set_child_index_enabled(bool enabled);
+		/**
+		 * \brief Check if the per-node child index is enabled.
+		 * \return Whether children are indexed by key.
+		 */
+		bool is_child_index_enabled() const;
+		/**
+		 * \brief Find a child by key, in constant time when the child index is enabled and by scanning the children otherwise.
+		 * \param parentHandle The handle of the parent node.
+		 * \param key The key of the child.
+		 * \return The handle of the child, or -1 if there is no child with this key.
+		 */
+		handle find_child(handle parentHandle, std::string_view key) const;
+		/**
+		 * \brief Update the child index after the key of a node changed.
+		 * \param targetHandle The handle of the node whose key changed.
+		 * \param oldKey The key the node was indexed under.
+		 */
+		void reindex_child(handle targetHandle, std::string_view oldKey);
+		/**
+		 * \brief Choose the order recycled handles are reused in. The handles already in the pool are kept. A value
+		 * outside the enum throws invalid_pool_policy and leaves the policy unchanged.
+		 * \param policy The policy.
+		 */
+		void set_pool_policy(pool_policy policy);
+		/**
+		 * \brief Get the order recycled handles are reused in.
+		 * \return The policy.
+		 */
+		pool_policy get_pool_policy() const;
+		/**
+		 * \brief Renumber the live nodes into a dense prefix of the storage in preorder, and release the recycled slots.
+		 * Every subtree then occupies the contiguous handles [h, get_subtree_end(h)), so a subtree scan is a linear
+		 * sweep. The root keeps handle 0, children keep their order, and every tagged handle taken before is stale afterwards.
+		 * \return The new handle of every old handle, -1 for the recycled ones.
+		 */
+		std::vector<handle> compact();
+		/**
+		 * \brief Check if the storage is still in the preorder left by compact: nothing was allocated, moved or removed since.
+		 * \return Whether every subtree is a contiguous range of handles.
+		 */
+		bool is_preorder_layout() const;
+		/**
+		 * \brief Get the end of the range of handles a subtree occupies, while the storage is in preorder.
+		 * \param h The handle of the root of the subtree.
+		 * \return One past the last handle of the subtree, or -1 if the storage is no longer in preorder.
+		 */
+		handle get_subtree_end(handle h) const;
+		/**
+		 * \brief Estimate how far the storage has drifted from the preorder left by compact, to decide when to compact again.
+		 * \return The share of slots that are recycled or were allocated or moved since, between 0 and 1.
+		 */
+		double get_fragmentation() const;
+		/**
+		 * \brief Get the recycled handles in the order they will be reused.
+		 * \return The handles in the pool.
+		 */
+		std::vector<handle> peek_pool() const;
+		/**
+		 * \brief Start restoring a saved tree: one slot per generation, all recycled except the root, and an empty pool.
+		 * \param generations The generation of every slot.
+		 */
+		void restore_reset(const std::vector<unsigned int>& generations);
+		/**
+		 * \brief Restore a live node into its saved slot, appended to its parent's children. Parents must be restored first.
+		 * \param h The handle of the node.
+		 * \param parentHandle The handle of the parent node, -1 to restore the root's data.
+		 * \param data The content of the node.
+		 */
+		void restore_node(handle h, handle parentHandle, const tree_node_data& data);
+		/**
+		 * \brief Finish restoring a saved tree by setting the pool.
+		 * \param pool The recycled handles in the order they will be reused.
+		 */
+		void restore_pool(const std::vector<handle>& pool);
 	private:
+		/**
+		 * \brief Take a recycled handle according to the pool policy.
+		 * \param parentHandle The handle of the parent the node is allocated under.
+		 * \return The handle, or -1 if the pool is empty.
+		 */
+		handle take_from_pool(handle parentHandle);
+		/**
+		 * \brief Give a recycled handle back to the pool.
+		 * \param h The handle.
+		 */
+		void return_to_pool(handle h);
+		/**
+		 * \brief Add a node to its parent's child index.
+		 * \param h The handle of the node.
+		 */
+		void index_child(handle h);
+		/**
+		 * \brief Remove a node from its parent's child index.
+		 * \param h The handle of the node.
+		 * \param key The key the node is indexed under.
+		 */
+		void unindex_child(handle h, std::string_view key);
+		/**
+		 * \brief Copy the parent, liveness and generation of a node into the dense arrays.
+		 * \param h The handle of the node.
+		 */
+		void sync_dense(handle h);
+		/**
+		 * \brief Check in debug builds that the dense arrays still match a node. Does nothing when NDEBUG is defined.
+		 * \param h The handle of the node.
+		 */
+		void check_dense(handle h) const;
+		/**
+		 * \brief Append a node to the end of its parent's child list.
+		 * \param h The handle of the node, whose parent handle is already set.
+		 */
+		void link_child(handle h);
+		/**
+		 * \brief Take a node out of its parent's child list in constant time.
+		 * \param h The handle of the node.
+		 */
+		void unlink_child(handle h);
 
 		/**
-		 * The storage for all nodes.
+		 * The storage for all nodes, in chunks so nodes never move and references to them stay valid as the tree grows.
+		 */
+		chunked_vector<tree_node<tree_node_data>> m_nodes {};
+		/**
+		 * The pool that keep track of the recycled nodes, in the order they were freed, for the Fifo and Lifo policies.
+		 */
+		std::deque<handle> m_node_pool {};
+		/**
+		 * The recycled nodes in handle order, for the NearParent policy.
+		 */
+		std::set<handle> m_near_pool {};
+		/**
+		 * The order recycled nodes are reused in.
+		 */
+		pool_policy m_pool_policy = pool_policy::Fifo;
+		/**
+		 * The parent handle of every node, kept in a dense array so ancestor walks do not pull whole nodes into cache.
 		 */
-		std::vector<tree_node<tree_node_data>> m_nodes {};
+		chunked_vector<handle> m_parents {};
 		/**
-		 * The pool that keep track of the recycled nodes.
+		 * Whether every node is allocated, kept in a dense array for liveness checks.
 		 */
-		std::queue<handle> m_node_pool {};
+		chunked_vector<unsigned char> m_alive {};
+		/**
+		 * The generation of every node, kept in a dense array for tagged handle checks.
+		 */
+		chunked_vector<unsigned int> m_generations {};
+		/**
+		 * One past the last handle of every subtree, filled by compact.
+		 */
+		chunked_vector<handle> m_subtreeEnds {};
+		/**
+		 * The amount of allocations and moves since the storage was last laid out in preorder.
+		 */
+		size_t m_unorderedCount = 0;
+		/**
+		 * The function that gives the key of a node, used by the child index.
+		 */
+		std::function<std::string_view(const tree_node_data&)> m_childKey {};
+		/**
+		 * Whether children are indexed by key.
+		 */
+		bool m_childIndexEnabled = false;
 	};
 
 	template <typename tree_node_data>
@@ -124,6 +480,11 @@ namespace cs251 {
         }
 	}
 
+	template <typename tree_node_data>
+	const tree_node_data& tree_node<tree_node_data>::peek_data() const {
+        return m_data;
+	}
+
 	template <typename tree_node_data>
 	bool tree_node<tree_node_data>::is_recycled() const {
         return m_recycled;
@@ -134,6 +495,11 @@ namespace cs251 {
         return m_handle;
 	}
 
+	template <typename tree_node_data>
+	unsigned int tree_node<tree_node_data>::get_generation() const {
+        return m_generation;
+	}
+
 	template <typename tree_node_data>
 	handle tree_node<tree_node_data>::get_parent_handle() const {
 		if (!m_recycled) {
@@ -144,9 +510,27 @@ namespace cs251 {
 	}
 
 	template <typename tree_node_data>
-	const std::vector<handle>& tree_node<tree_node_data>::peek_children_handles() const {
+	handle tree_node<tree_node_data>::get_first_child_handle() const {
+		if (!m_recycled) {
+            return m_firstChildHandle;
+        } else {
+            throw recycled_node();
+        }
+	}
+
+	template <typename tree_node_data>
+	handle tree_node<tree_node_data>::get_next_sibling_handle() const {
 		if (!m_recycled) {
-            return m_childrenHandles;
+            return m_nextSiblingHandle;
+        } else {
+            throw recycled_node();
+        }
+	}
+
+	template <typename tree_node_data>
+	size_t tree_node<tree_node_data>::get_child_count() const {
+		if (!m_recycled) {
+            return m_childCount;
         } else {
             throw recycled_node();
         }
@@ -159,66 +543,86 @@ namespace cs251 {
         m_nodes[0].m_recycled = false;
         m_nodes[0].m_parentHandle = -1;
         m_nodes[0].m_data = {};
-        m_nodes[0].m_childrenHandles = {};
+        sync_dense(0);
+        m_subtreeEnds.emplace_back(1);
 	}
 
 	template <typename tree_node_data>
-	handle tree<tree_node_data>::allocate(handle parentHandle) {
+	handle tree<tree_node_data>::allocate(const handle parentHandle) {
+        return allocate(parentHandle, tree_node_data{});
+	}
+
+	template <typename tree_node_data>
+	handle tree<tree_node_data>::allocate(const handle parentHandle, const tree_node_data& data) {
         if ((parentHandle < 0) || (parentHandle >= static_cast<handle>(m_nodes.size()))) {
             throw invalid_handle();
         }
         if (m_nodes[parentHandle].m_recycled) {
             throw recycled_node();
         }
-        handle childHandle;
-		if (m_node_pool.empty()) {
+        handle childHandle = take_from_pool(parentHandle);
+		if (childHandle == -1) {
             childHandle = m_nodes.size();
-            m_nodes.push_back(tree_node<tree_node_data>());
-        } else {
-            childHandle = m_node_pool.front();
-            m_node_pool.pop();
+            m_nodes.emplace_back();
         }
         m_nodes[childHandle].m_handle = childHandle;
         m_nodes[childHandle].m_recycled = false;
         m_nodes[childHandle].m_parentHandle = parentHandle;
-        m_nodes[parentHandle].m_childrenHandles.push_back(childHandle);
+        m_nodes[childHandle].m_data = data;
+        link_child(childHandle);
+        sync_dense(childHandle);
+        index_child(childHandle);
+        m_unorderedCount += 1;
         return childHandle;
 	}
 
 	template <typename tree_node_data>
-	void tree<tree_node_data>::remove(const handle h) {
+	std::vector<handle> tree<tree_node_data>::remove(const handle h) {
 		if ((h <= 0) || (h >= static_cast<handle>(m_nodes.size()))) {
             throw invalid_handle();
         }
         if (m_nodes[h].m_recycled) {
             throw recycled_node();
         }
-        if (!m_nodes[h].m_childrenHandles.empty()) {
-            std::vector<handle> children = m_nodes[h].m_childrenHandles;
-            for (handle childHandle : children) {
-                if ((childHandle > 0) && (h < static_cast<handle>(m_nodes.size()))) {
-                    if (!m_nodes[childHandle].m_recycled) {
-                        remove(childHandle);
-                    }
-                }
-            }
+        if (m_childIndexEnabled) {
+            unindex_child(h, m_childKey(m_nodes[h].m_data));
         }
-        handle parentHandle = m_nodes[h].m_parentHandle;
-        if (parentHandle != -1) {
-            std::vector<handle>& children = m_nodes[parentHandle].m_childrenHandles;
-            std::vector<handle>::iterator it = children.begin();
-            while (it != children.end()) {
-                if (*it == h) {
-                    it = children.erase(it);
-                } else {
-                    ++it;
+        unlink_child(h);
+        // Post-order walk over the sibling links: no recursion, no stack, no copied child lists.
+        std::vector<handle> freed;
+        handle current = h;
+        while (m_nodes[current].m_firstChildHandle != -1) {
+            current = m_nodes[current].m_firstChildHandle;
+        }
+        while (true) {
+            freed.push_back(current);
+            if (current == h) {
+                break;
+            }
+            if (m_nodes[current].m_nextSiblingHandle != -1) {
+                current = m_nodes[current].m_nextSiblingHandle;
+                while (m_nodes[current].m_firstChildHandle != -1) {
+                    current = m_nodes[current].m_firstChildHandle;
                 }
+            } else {
+                current = m_nodes[current].m_parentHandle;
             }
         }
-        m_nodes[h].m_childrenHandles.clear();
-        m_nodes[h].m_recycled = true;
-        m_nodes[h].m_parentHandle = -1;
-        m_node_pool.push(h);   
+        for (handle freedHandle : freed) {
+            tree_node<tree_node_data>& node = m_nodes[freedHandle];
+            node.m_firstChildHandle = -1;
+            node.m_lastChildHandle = -1;
+            node.m_prevSiblingHandle = -1;
+            node.m_nextSiblingHandle = -1;
+            node.m_childCount = 0;
+            node.m_childIndex.clear();
+            node.m_recycled = true;
+            node.m_generation += 1;
+            node.m_parentHandle = -1;
+            sync_dense(freedHandle);
+            return_to_pool(freedHandle);
+        }
+        return freed;
 	}
 
 	template <typename tree_node_data>
@@ -229,27 +633,33 @@ namespace cs251 {
         if (m_nodes[targetHandle].m_recycled || m_nodes[parentHandle].m_recycled) {
             throw recycled_node();
         }
-        if (m_nodes[parentHandle].m_parentHandle == targetHandle) {
+        if ((targetHandle == parentHandle) || (m_nodes[parentHandle].m_parentHandle == targetHandle)) {
             throw invalid_handle();
         }
         handle oldParent = m_nodes[targetHandle].m_parentHandle;
         if ((oldParent >= 0) && (oldParent < m_nodes.size()) && (!m_nodes[oldParent].m_recycled)) {
-            std::vector<handle>& oldParentsChildren = m_nodes[oldParent].m_childrenHandles;
-            std::vector<handle>::iterator it = oldParentsChildren.begin();
-            while (it != oldParentsChildren.end()) {
-                if (*it == targetHandle) {
-                    it = oldParentsChildren.erase(it);
-                } else {
-                    ++it;
-                }
+            if (m_childIndexEnabled) {
+                unindex_child(targetHandle, m_childKey(m_nodes[targetHandle].m_data));
             }
+            unlink_child(targetHandle);
         }
         m_nodes[targetHandle].m_parentHandle = parentHandle;
-        m_nodes[parentHandle].m_childrenHandles.push_back(targetHandle);
+        link_child(targetHandle);
+        sync_dense(targetHandle);
+        index_child(targetHandle);
+        m_unorderedCount += 1;
     }
 
 	template <typename tree_node_data>
-	const std::vector<tree_node<tree_node_data>>& tree<tree_node_data>::peek_nodes() const {
+	void tree<tree_node_data>::reserve(const size_t count) {
+        m_nodes.reserve(count);
+        m_parents.reserve(count);
+        m_alive.reserve(count);
+        m_generations.reserve(count);
+	}
+
+	template <typename tree_node_data>
+	const chunked_vector<tree_node<tree_node_data>>& tree<tree_node_data>::peek_nodes() const {
 		return m_nodes;
 	}
 
@@ -259,5 +669,427 @@ namespace cs251 {
             throw invalid_handle();
         }
         return m_nodes[h];
-    }    
+    }
+
+	template <typename tree_node_data>
+	child_range<tree_node_data> tree<tree_node_data>::peek_children(const handle h) const {
+		if ((h < 0) || (h >= static_cast<handle>(m_nodes.size()))) {
+            throw invalid_handle();
+        }
+        if (m_nodes[h].m_recycled) {
+            throw recycled_node();
+        }
+        return child_range<tree_node_data>(this, m_nodes[h].m_firstChildHandle, m_nodes[h].m_childCount);
+	}
+
+	template <typename tree_node_data>
+	bool tree<tree_node_data>::is_alive(const handle h) const {
+        check_dense(h);
+        return (h >= 0) && (h < static_cast<handle>(m_alive.size())) && m_alive[h];
+	}
+
+	template <typename tree_node_data>
+	bool tree<tree_node_data>::is_alive(const tagged_handle& taggedHandle) const {
+        return is_alive(taggedHandle.m_handle) && (m_generations[taggedHandle.m_handle] == taggedHandle.m_generation);
+	}
+
+	template <typename tree_node_data>
+	tagged_handle tree<tree_node_data>::get_tagged_handle(const handle h) const {
+        if (!is_alive(h)) {
+            throw invalid_handle();
+        }
+        tagged_handle taggedHandle;
+        taggedHandle.m_handle = h;
+        taggedHandle.m_generation = m_generations[h];
+        return taggedHandle;
+	}
+
+	template <typename tree_node_data>
+	handle tree<tree_node_data>::get_parent(const handle h) const {
+        if ((h < 0) || (h >= static_cast<handle>(m_alive.size()))) {
+            throw invalid_handle();
+        }
+        if (!m_alive[h]) {
+            throw recycled_node();
+        }
+        check_dense(h);
+        return m_parents[h];
+	}
+
+	template <typename tree_node_data>
+	size_t tree<tree_node_data>::get_depth(const handle h) const {
+        size_t depth = 0;
+        for (handle parentHandle = get_parent(h); parentHandle != -1; parentHandle = m_parents[parentHandle]) {
+            depth += 1;
+        }
+        return depth;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::set_child_key(std::function<std::string_view(const tree_node_data&)> keyFunction) {
+        m_childKey = std::move(keyFunction);
+        if (m_childIndexEnabled) {
+            set_child_index_enabled(false);
+            set_child_index_enabled(true);
+        }
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::set_child_index_enabled(const bool enabled) {
+        if (enabled && !m_childKey) {
+            throw child_key_unset();
+        }
+        m_childIndexEnabled = enabled;
+        for (tree_node<tree_node_data>& node : m_nodes) {
+            node.m_childIndex.clear();
+        }
+        if (enabled) {
+            for (const tree_node<tree_node_data>& node : m_nodes) {
+                if (!node.m_recycled) {
+                    index_child(node.m_handle);
+                }
+            }
+        }
+	}
+
+	template <typename tree_node_data>
+	bool tree<tree_node_data>::is_child_index_enabled() const {
+        return m_childIndexEnabled;
+	}
+
+	template <typename tree_node_data>
+	handle tree<tree_node_data>::find_child(const handle parentHandle, const std::string_view key) const {
+        if (!is_alive(parentHandle)) {
+            throw invalid_handle();
+        }
+        const tree_node<tree_node_data>& parent = m_nodes[parentHandle];
+        if (m_childIndexEnabled) {
+            auto it = parent.m_childIndex.find(key);
+            return it == parent.m_childIndex.end() ? -1 : it->second;
+        }
+        if (!m_childKey) {
+            throw child_key_unset();
+        }
+        for (handle childHandle = parent.m_firstChildHandle; childHandle != -1; childHandle = m_nodes[childHandle].m_nextSiblingHandle) {
+            if (m_childKey(m_nodes[childHandle].m_data) == key) {
+                return childHandle;
+            }
+        }
+        return -1;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::reindex_child(const handle targetHandle, const std::string_view oldKey) {
+        if (!is_alive(targetHandle)) {
+            throw invalid_handle();
+        }
+        if (!m_childIndexEnabled) {
+            return;
+        }
+        unindex_child(targetHandle, oldKey);
+        index_child(targetHandle);
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::index_child(const handle h) {
+        handle parentHandle = m_nodes[h].m_parentHandle;
+        if (!m_childIndexEnabled || (parentHandle == -1)) {
+            return;
+        }
+        m_nodes[parentHandle].m_childIndex.emplace(m_childKey(m_nodes[h].m_data), h);
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::unindex_child(const handle h, const std::string_view key) {
+        handle parentHandle = m_nodes[h].m_parentHandle;
+        if (parentHandle == -1) {
+            return;
+        }
+        std::unordered_map<std::string_view, handle>& index = m_nodes[parentHandle].m_childIndex;
+        auto it = index.find(key);
+        if ((it != index.end()) && (it->second == h)) {
+            index.erase(it);
+        }
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::sync_dense(const handle h) {
+        if (h >= static_cast<handle>(m_parents.size())) {
+            m_parents.resize(m_nodes.size(), -1);
+            m_alive.resize(m_nodes.size(), 0);
+            m_generations.resize(m_nodes.size(), 0);
+        }
+        m_parents[h] = m_nodes[h].m_parentHandle;
+        m_alive[h] = !m_nodes[h].m_recycled;
+        m_generations[h] = m_nodes[h].m_generation;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::check_dense(const handle h) const {
+        assert((h < 0) || (h >= static_cast<handle>(m_alive.size())) || (h >= static_cast<handle>(m_nodes.size()))
+            || ((m_parents[h] == m_nodes[h].m_parentHandle) && ((m_alive[h] != 0) == !m_nodes[h].m_recycled)
+                && (m_generations[h] == m_nodes[h].m_generation)));
+        (void)h;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::link_child(const handle h) {
+        tree_node<tree_node_data>& parent = m_nodes[m_nodes[h].m_parentHandle];
+        m_nodes[h].m_prevSiblingHandle = parent.m_lastChildHandle;
+        m_nodes[h].m_nextSiblingHandle = -1;
+        if (parent.m_lastChildHandle == -1) {
+            parent.m_firstChildHandle = h;
+        } else {
+            m_nodes[parent.m_lastChildHandle].m_nextSiblingHandle = h;
+        }
+        parent.m_lastChildHandle = h;
+        parent.m_childCount += 1;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::unlink_child(const handle h) {
+        tree_node<tree_node_data>& node = m_nodes[h];
+        tree_node<tree_node_data>& parent = m_nodes[node.m_parentHandle];
+        if (node.m_prevSiblingHandle == -1) {
+            parent.m_firstChildHandle = node.m_nextSiblingHandle;
+        } else {
+            m_nodes[node.m_prevSiblingHandle].m_nextSiblingHandle = node.m_nextSiblingHandle;
+        }
+        if (node.m_nextSiblingHandle == -1) {
+            parent.m_lastChildHandle = node.m_prevSiblingHandle;
+        } else {
+            m_nodes[node.m_nextSiblingHandle].m_prevSiblingHandle = node.m_prevSiblingHandle;
+        }
+        node.m_prevSiblingHandle = -1;
+        node.m_nextSiblingHandle = -1;
+        parent.m_childCount -= 1;
+	}
+
+	template <typename tree_node_data>
+	handle tree<tree_node_data>::take_from_pool(const handle parentHandle) {
+        handle h = -1;
+        switch (m_pool_policy)
+        {
+        case pool_policy::Fifo:
+            if (!m_node_pool.empty()) {
+                h = m_node_pool.front();
+                m_node_pool.pop_front();
+            }
+            break;
+        case pool_policy::Lifo:
+            if (!m_node_pool.empty()) {
+                h = m_node_pool.back();
+                m_node_pool.pop_back();
+            }
+            break;
+        case pool_policy::NearParent:
+            if (!m_near_pool.empty()) {
+                // The closest free slot on either side of the parent.
+                auto after = m_near_pool.lower_bound(parentHandle);
+                auto chosen = after;
+                if (after == m_near_pool.end()) {
+                    chosen = std::prev(after);
+                } else if (after != m_near_pool.begin()) {
+                    auto before = std::prev(after);
+                    if (parentHandle - *before < *after - parentHandle) {
+                        chosen = before;
+                    }
+                }
+                h = *chosen;
+                m_near_pool.erase(chosen);
+            }
+            break;
+        }
+        return h;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::return_to_pool(const handle h) {
+        if (m_pool_policy == pool_policy::NearParent) {
+            m_near_pool.insert(h);
+        } else {
+            m_node_pool.push_back(h);
+        }
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::set_pool_policy(const pool_policy policy) {
+        if (static_cast<unsigned>(policy) > static_cast<unsigned>(pool_policy::NearParent)) {
+            throw invalid_pool_policy();
+        }
+        const std::vector<handle> pool = peek_pool();
+        m_node_pool.clear();
+        m_near_pool.clear();
+        m_pool_policy = policy;
+        restore_pool(pool);
+	}
+
+	template <typename tree_node_data>
+	pool_policy tree<tree_node_data>::get_pool_policy() const {
+        return m_pool_policy;
+	}
+
+	template <typename tree_node_data>
+	std::vector<handle> tree<tree_node_data>::compact() {
+        // Preorder over the sibling links, without a stack.
+        std::vector<handle> order;
+        handle current = 0;
+        while (true) {
+            order.push_back(current);
+            if (m_nodes[current].m_firstChildHandle != -1) {
+                current = m_nodes[current].m_firstChildHandle;
+                continue;
+            }
+            while ((current != 0) && (m_nodes[current].m_nextSiblingHandle == -1)) {
+                current = m_nodes[current].m_parentHandle;
+            }
+            if (current == 0) {
+                break;
+            }
+            current = m_nodes[current].m_nextSiblingHandle;
+        }
+        std::vector<handle> remap(m_nodes.size(), -1);
+        for (size_t i = 0; i < order.size(); i++) {
+            remap[order[i]] = static_cast<handle>(i);
+        }
+        // One generation above every slot's, so no tagged handle of the old numbering matches a new node.
+        unsigned int generation = 0;
+        for (size_t i = 0; i < m_generations.size(); i++) {
+            generation = std::max(generation, m_generations[i]);
+        }
+        generation += 1;
+        chunked_vector<tree_node<tree_node_data>> nodes;
+        nodes.reserve(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            tree_node<tree_node_data>& oldNode = m_nodes[order[i]];
+            tree_node<tree_node_data>& node = nodes.emplace_back();
+            node.m_handle = static_cast<handle>(i);
+            node.m_generation = generation;
+            node.m_recycled = false;
+            node.m_parentHandle = i == 0 ? -1 : remap[oldNode.m_parentHandle];
+            node.m_data = std::move(oldNode.m_data);
+        }
+        m_nodes = std::move(nodes);
+        m_parents = chunked_vector<handle>();
+        m_alive = chunked_vector<unsigned char>();
+        m_generations = chunked_vector<unsigned int>();
+        m_node_pool.clear();
+        m_near_pool.clear();
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            const handle h = static_cast<handle>(i);
+            if (h != 0) {
+                link_child(h);
+            }
+            sync_dense(h);
+            if (h != 0) {
+                index_child(h);
+            }
+        }
+        // In preorder a subtree ends where its last descendant does; children come after their parents.
+        m_subtreeEnds = chunked_vector<handle>();
+        m_subtreeEnds.reserve(m_nodes.size());
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            m_subtreeEnds.emplace_back(static_cast<handle>(i + 1));
+        }
+        for (size_t i = m_nodes.size() - 1; i > 0; i--) {
+            handle& parentEnd = m_subtreeEnds[m_parents[i]];
+            parentEnd = std::max(parentEnd, m_subtreeEnds[i]);
+        }
+        m_unorderedCount = 0;
+        return remap;
+	}
+
+	template <typename tree_node_data>
+	bool tree<tree_node_data>::is_preorder_layout() const {
+        return (m_unorderedCount == 0) && m_node_pool.empty() && m_near_pool.empty() && (m_subtreeEnds.size() == m_nodes.size());
+	}
+
+	template <typename tree_node_data>
+	handle tree<tree_node_data>::get_subtree_end(const handle h) const {
+        if (!is_alive(h)) {
+            throw invalid_handle();
+        }
+        return is_preorder_layout() ? m_subtreeEnds[h] : -1;
+	}
+
+	template <typename tree_node_data>
+	double tree<tree_node_data>::get_fragmentation() const {
+        const size_t unordered = m_unorderedCount + m_node_pool.size() + m_near_pool.size();
+        return std::min(1.0, static_cast<double>(unordered) / static_cast<double>(m_nodes.size()));
+	}
+
+	template <typename tree_node_data>
+	std::vector<handle> tree<tree_node_data>::peek_pool() const {
+        if (m_pool_policy == pool_policy::NearParent) {
+            return std::vector<handle>(m_near_pool.begin(), m_near_pool.end());
+        }
+        if (m_pool_policy == pool_policy::Lifo) {
+            return std::vector<handle>(m_node_pool.rbegin(), m_node_pool.rend());
+        }
+        return std::vector<handle>(m_node_pool.begin(), m_node_pool.end());
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::restore_reset(const std::vector<unsigned int>& generations) {
+        if (generations.empty()) {
+            throw invalid_handle();
+        }
+        m_nodes.clear();
+        m_nodes.resize(generations.size());
+        m_parents.clear();
+        m_alive.clear();
+        m_generations.clear();
+        m_node_pool.clear();
+        m_near_pool.clear();
+        m_subtreeEnds.clear();
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            m_nodes[i].m_handle = static_cast<handle>(i);
+            m_nodes[i].m_generation = generations[i];
+        }
+        m_nodes[0].m_recycled = false;
+        for (size_t i = 0; i < m_nodes.size(); i++) {
+            sync_dense(static_cast<handle>(i));
+        }
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::restore_node(const handle h, const handle parentHandle, const tree_node_data& data) {
+        if (parentHandle == -1) {
+            if (h != 0) {
+                throw invalid_handle();
+            }
+            m_nodes[0].m_data = data;
+            return;
+        }
+        if ((h <= 0) || (h >= static_cast<handle>(m_nodes.size())) || !m_nodes[h].m_recycled || !is_alive(parentHandle)) {
+            throw invalid_handle();
+        }
+        m_nodes[h].m_recycled = false;
+        m_nodes[h].m_parentHandle = parentHandle;
+        m_nodes[h].m_data = data;
+        link_child(h);
+        sync_dense(h);
+        index_child(h);
+        m_unorderedCount += 1;
+	}
+
+	template <typename tree_node_data>
+	void tree<tree_node_data>::restore_pool(const std::vector<handle>& pool) {
+        // A handle in the pool twice would be handed out to two nodes.
+        std::vector<bool> pooled(m_nodes.size(), false);
+        for (handle h : pool) {
+            if ((h <= 0) || (h >= static_cast<handle>(m_nodes.size())) || !m_nodes[h].m_recycled || pooled[h]) {
+                throw invalid_handle();
+            }
+            pooled[h] = true;
+        }
+        // The pool is given in reuse order, so the stack of the Lifo policy is filled from the back.
+        if (m_pool_policy == pool_policy::Lifo) {
+            m_node_pool.insert(m_node_pool.end(), pool.rbegin(), pool.rend());
+        } else {
+            for (handle h : pool) {
+                return_to_pool(h);
+            }
+        }
+	}
 }
\ No newline at end of file
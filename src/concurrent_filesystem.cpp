@@ -0,0 +1,81 @@
+#include "concurrent_filesystem.hpp"
+
+using namespace cs251;
+
+concurrent_filesystem::concurrent_filesystem(const size_t sizeLimit) : m_fileSystem(sizeLimit) {
+    // Readers never touch the cache, so it would only cost the writers.
+    m_fileSystem.set_path_cache_capacity(0);
+}
+
+handle concurrent_filesystem::create_file(const size_t fileSize, const std::string& fileName, const handle parentHandle) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.create_file(fileSize, fileName, parentHandle);
+}
+
+handle concurrent_filesystem::create_directory(const std::string& directoryName, const handle parentHandle) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.create_directory(directoryName, parentHandle);
+}
+
+handle concurrent_filesystem::create_link(const handle targetHandle, const std::string& linkName, const handle parentHandle) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.create_link(targetHandle, linkName, parentHandle);
+}
+
+bool concurrent_filesystem::remove(const handle targetHandle) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.remove(targetHandle);
+}
+
+size_t concurrent_filesystem::remove_recursive(const handle targetHandle) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.remove_recursive(targetHandle);
+}
+
+void concurrent_filesystem::resize_file(const handle targetHandle, const size_t newSize) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_fileSystem.resize_file(targetHandle, newSize);
+}
+
+void concurrent_filesystem::move(const handle targetHandle, const handle parentHandle) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_fileSystem.move(targetHandle, parentHandle);
+}
+
+void concurrent_filesystem::rename(const handle targetHandle, const std::string& newName) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_fileSystem.rename(targetHandle, newName);
+}
+
+handle concurrent_filesystem::get_handle(const std::string_view path, const handle startHandle) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.peek_handle(path, startHandle);
+}
+
+bool concurrent_filesystem::exist(const handle targetHandle) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.exist(targetHandle);
+}
+
+std::string concurrent_filesystem::get_name(const handle targetHandle) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (!m_fileSystem.exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    return std::string(m_fileSystem.peek_name(targetHandle));
+}
+
+size_t concurrent_filesystem::get_file_size(const handle targetHandle) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.peek_file_size(targetHandle);
+}
+
+size_t concurrent_filesystem::get_file_size(const std::string_view path) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.peek_file_size(m_fileSystem.peek_handle(path));
+}
+
+handle concurrent_filesystem::get_largest_file_handle() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_fileSystem.get_largest_file_handle();
+}
@@ -0,0 +1,187 @@
+#include "file_size_index.hpp"
+#include "algorithm"
+using namespace cs251;
+
+void file_size_index::insert(const size_t fileSize, const handle handle) {
+    int index = create_node(fileSize, handle);
+    int left;
+    int right;
+    split(m_root, fileSize, handle, left, right);
+    m_root = merge(merge(left, index), right);
+}
+
+void file_size_index::insert_all(std::vector<std::pair<size_t, handle>> files) {
+    if (m_root != -1) {
+        for (const std::pair<size_t, handle>& file : files) {
+            insert(file.first, file.second);
+        }
+        return;
+    }
+    std::sort(files.begin(), files.end());
+    // Build the treap left to right; the stack holds the right spine, highest priority at the bottom.
+    std::vector<int> spine;
+    for (const std::pair<size_t, handle>& file : files) {
+        int index = create_node(file.first, file.second);
+        int last = -1;
+        while (!spine.empty() && m_nodes[spine.back()].m_priority < m_nodes[index].m_priority) {
+            last = spine.back();
+            spine.pop_back();
+            refresh(last);
+        }
+        m_nodes[index].m_left = last;
+        if (!spine.empty()) {
+            m_nodes[spine.back()].m_right = index;
+        }
+        spine.push_back(index);
+    }
+    while (!spine.empty()) {
+        refresh(spine.back());
+        m_root = spine.back();
+        spine.pop_back();
+    }
+}
+
+void file_size_index::remove(const size_t fileSize, const handle handle) {
+    int left;
+    int right;
+    split(m_root, fileSize, handle, left, right);
+    int middle = right;
+    while ((middle != -1) && (m_nodes[middle].m_left != -1)) {
+        middle = m_nodes[middle].m_left;
+    }
+    if ((middle == -1) || (m_nodes[middle].m_value != fileSize) || (m_nodes[middle].m_handle != handle)) {
+        m_root = merge(left, right);
+        throw invalid_handle();
+    }
+    int rest;
+    int found;
+    split(right, fileSize, handle + 1, found, rest);
+    m_node_pool.push_back(found);
+    m_root = merge(left, rest);
+}
+
+size_t file_size_index::count_in_range(const size_t minSize, const size_t maxSize) const {
+    if (minSize > maxSize) {
+        return 0;
+    }
+    size_t upperCount;
+    size_t upperBytes;
+    prefix(maxSize, upperCount, upperBytes);
+    if (minSize == 0) {
+        return upperCount;
+    }
+    size_t lowerCount;
+    size_t lowerBytes;
+    prefix(minSize - 1, lowerCount, lowerBytes);
+    return upperCount - lowerCount;
+}
+
+size_t file_size_index::bytes_in_range(const size_t minSize, const size_t maxSize) const {
+    if (minSize > maxSize) {
+        return 0;
+    }
+    size_t upperCount;
+    size_t upperBytes;
+    prefix(maxSize, upperCount, upperBytes);
+    if (minSize == 0) {
+        return upperBytes;
+    }
+    size_t lowerCount;
+    size_t lowerBytes;
+    prefix(minSize - 1, lowerCount, lowerBytes);
+    return upperBytes - lowerBytes;
+}
+
+size_t file_size_index::size() const {
+    return m_root == -1 ? 0 : m_nodes[m_root].m_count;
+}
+
+void file_size_index::prefix(const size_t maxSize, size_t& count, size_t& bytes) const {
+    count = 0;
+    bytes = 0;
+    int index = m_root;
+    while (index != -1) {
+        const file_size_index_node& node = m_nodes[index];
+        if (node.m_value <= maxSize) {
+            if (node.m_left != -1) {
+                count += m_nodes[node.m_left].m_count;
+                bytes += m_nodes[node.m_left].m_bytes;
+            }
+            count += 1;
+            bytes += node.m_value;
+            index = node.m_right;
+        } else {
+            index = node.m_left;
+        }
+    }
+}
+
+void file_size_index::split(const int root, const size_t value, const handle handle, int& left, int& right) {
+    if (root == -1) {
+        left = -1;
+        right = -1;
+        return;
+    }
+    file_size_index_node& node = m_nodes[root];
+    if ((node.m_value < value) || ((node.m_value == value) && (node.m_handle < handle))) {
+        split(node.m_right, value, handle, m_nodes[root].m_right, right);
+        left = root;
+    } else {
+        split(node.m_left, value, handle, left, m_nodes[root].m_left);
+        right = root;
+    }
+    refresh(root);
+}
+
+int file_size_index::merge(const int left, const int right) {
+    if (left == -1) {
+        return right;
+    }
+    if (right == -1) {
+        return left;
+    }
+    if (m_nodes[left].m_priority > m_nodes[right].m_priority) {
+        m_nodes[left].m_right = merge(m_nodes[left].m_right, right);
+        refresh(left);
+        return left;
+    }
+    m_nodes[right].m_left = merge(left, m_nodes[right].m_left);
+    refresh(right);
+    return right;
+}
+
+int file_size_index::create_node(const size_t fileSize, const handle handle) {
+    int index;
+    if (m_node_pool.empty()) {
+        index = m_nodes.size();
+        m_nodes.emplace_back();
+    } else {
+        index = m_node_pool.back();
+        m_node_pool.pop_back();
+    }
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    file_size_index_node& node = m_nodes[index];
+    node.m_value = fileSize;
+    node.m_handle = handle;
+    node.m_priority = m_seed;
+    node.m_left = -1;
+    node.m_right = -1;
+    refresh(index);
+    return index;
+}
+
+void file_size_index::refresh(const int index) {
+    file_size_index_node& node = m_nodes[index];
+    node.m_count = 1;
+    node.m_bytes = node.m_value;
+    if (node.m_left != -1) {
+        node.m_count += m_nodes[node.m_left].m_count;
+        node.m_bytes += m_nodes[node.m_left].m_bytes;
+    }
+    if (node.m_right != -1) {
+        node.m_count += m_nodes[node.m_right].m_count;
+        node.m_bytes += m_nodes[node.m_right].m_bytes;
+    }
+}
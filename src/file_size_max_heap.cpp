@@ -1,21 +1,42 @@
 #include "file_size_max_heap.hpp"
+#include "utility"
 using namespace cs251;
 
 void file_size_max_heap::push(const size_t fileSize, const handle handle) {
+    if (handle < 0) {
+        throw invalid_handle();
+    }
+    if (contains(handle)) {
+        update(handle, fileSize);
+        return;
+    }
+    if (handle >= static_cast<int>(m_positions.size())) {
+        m_positions.resize(handle + 1, -1);
+    }
     file_size_max_heap_node node;
     node.m_value = fileSize;
     node.m_handle = handle;
-    int i = m_nodeSize;
     m_nodes.push_back(node);
-    int p = (i - 1) / 2;
-    while ((i > 0) && (m_nodes[i].m_value > m_nodes[p].m_value)) {
-        file_size_max_heap_node temp = m_nodes[i];
-        m_nodes[i] = m_nodes[p];
-        m_nodes[p] = temp;
-        i = p;
-        p = (i - 1) / 2;
-    }          
+    m_positions[handle] = m_nodeSize;
     m_nodeSize += 1;
+    sift_up(m_nodeSize - 1);
+}
+
+void file_size_max_heap::push_all(const std::vector<file_size_max_heap_node>& nodes) {
+    for (const file_size_max_heap_node& node : nodes) {
+        if ((node.m_handle < 0) || contains(node.m_handle)) {
+            throw invalid_handle();
+        }
+    }
+    for (const file_size_max_heap_node& node : nodes) {
+        if (node.m_handle >= static_cast<int>(m_positions.size())) {
+            m_positions.resize(node.m_handle + 1, -1);
+        }
+        m_positions[node.m_handle] = m_nodeSize;
+        m_nodes.push_back(node);
+        m_nodeSize += 1;
+    }
+    heapify();
 }
 
 handle file_size_max_heap::top() const {
@@ -25,33 +46,130 @@ handle file_size_max_heap::top() const {
     return(m_nodes[0].m_handle);
 }
 
-void file_size_max_heap::remove(const handle handle) {
-    int index = -1;
-    for (int i = 0; i < m_nodeSize; i ++) {
-        if (m_nodes[i].m_handle == handle) {
-            index = i;
-            break;
+std::vector<handle> file_size_max_heap::top_k(const size_t k) const {
+    std::vector<handle> handles;
+    // The next largest file is always a child of one already taken, so only the frontier is kept.
+    std::priority_queue<std::pair<size_t, size_t>> frontier;
+    if (m_nodeSize > 0 && k > 0) {
+        frontier.push({ m_nodes[0].m_value, 0 });
+    }
+    while (!frontier.empty() && handles.size() < k) {
+        size_t index = frontier.top().second;
+        frontier.pop();
+        handles.push_back(m_nodes[index].m_handle);
+        for (size_t child = 2 * index + 1; child <= 2 * index + 2 && child < m_nodeSize; child++) {
+            frontier.push({ m_nodes[child].m_value, child });
         }
     }
-    m_nodes[index] = m_nodes[m_nodeSize - 1];
+    return handles;
+}
+
+void file_size_max_heap::remove(const handle handle) {
+    if (!contains(handle)) {
+        throw invalid_handle();
+    }
+    size_t index = m_positions[handle];
+    swap_nodes(index, m_nodeSize - 1);
     m_nodes.pop_back();
+    m_positions[handle] = -1;
     m_nodeSize -= 1;
-    int maxChild;
+    if (index < m_nodeSize) {
+        const cs251::handle moved = m_nodes[index].m_handle;
+        sift_up(index);
+        sift_down(m_positions[moved]);
+    }
+}
+
+void file_size_max_heap::remove_all(const std::vector<handle>& handles) {
+    size_t log = 1;
+    while ((static_cast<size_t>(1) << log) < m_nodeSize) {
+        log += 1;
+    }
+    if (handles.size() * log < m_nodeSize) {
+        for (handle h : handles) {
+            if (contains(h)) {
+                remove(h);
+            }
+        }
+        return;
+    }
+    for (handle h : handles) {
+        if (contains(h)) {
+            m_positions[h] = -1;
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < m_nodeSize; i++) {
+        if (m_positions[m_nodes[i].m_handle] != -1) {
+            m_nodes[kept] = m_nodes[i];
+            m_positions[m_nodes[kept].m_handle] = kept;
+            kept += 1;
+        }
+    }
+    m_nodes.resize(kept);
+    m_nodeSize = kept;
+    heapify();
+}
+
+void file_size_max_heap::update(const handle handle, const size_t fileSize) {
+    if (!contains(handle)) {
+        throw invalid_handle();
+    }
+    size_t index = m_positions[handle];
+    size_t oldSize = m_nodes[index].m_value;
+    m_nodes[index].m_value = fileSize;
+    if (fileSize > oldSize) {
+        sift_up(index);
+    } else {
+        sift_down(index);
+    }
+}
+
+bool file_size_max_heap::contains(const handle handle) const {
+    return (handle >= 0) && (handle < static_cast<int>(m_positions.size())) && (m_positions[handle] != -1);
+}
+
+const std::vector<file_size_max_heap_node>& file_size_max_heap::peek_nodes() const {
+    return m_nodes;
+}
+
+void file_size_max_heap::sift_up(size_t index) {
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (m_nodes[index].m_value <= m_nodes[parent].m_value) {
+            break;
+        }
+        swap_nodes(index, parent);
+        index = parent;
+    }
+}
+
+void file_size_max_heap::sift_down(size_t index) {
     while (index < m_nodeSize / 2) {
-        int leftChild = 2 * index + 1;
-        int rightChild = 2 * index + 2;
+        size_t leftChild = 2 * index + 1;
+        size_t rightChild = 2 * index + 2;
+        size_t maxChild = leftChild;
         if (rightChild < m_nodeSize && m_nodes[rightChild].m_value > m_nodes[leftChild].m_value) {
-            maxChild =  rightChild;   
-        } else {
-            maxChild = leftChild;    
+            maxChild = rightChild;
         }
-        if (m_nodes[maxChild].m_value > m_nodes[index].m_value) {
-            file_size_max_heap_node temp = m_nodes[maxChild];
-            m_nodes[maxChild] = m_nodes[index];
-            m_nodes[index] = temp;
-            index = maxChild;
-        } else {
-            break;    
+        if (m_nodes[maxChild].m_value <= m_nodes[index].m_value) {
+            break;
         }
+        swap_nodes(index, maxChild);
+        index = maxChild;
     }
-}
\ No newline at end of file
+}
+
+void file_size_max_heap::swap_nodes(const size_t a, const size_t b) {
+    file_size_max_heap_node temp = m_nodes[a];
+    m_nodes[a] = m_nodes[b];
+    m_nodes[b] = temp;
+    m_positions[m_nodes[a].m_handle] = a;
+    m_positions[m_nodes[b].m_handle] = b;
+}
+
+void file_size_max_heap::heapify() {
+    for (size_t i = m_nodeSize / 2; i > 0; i--) {
+        sift_down(i - 1);
+    }
+}
@@ -1,23 +1,31 @@
 #include "filesystem.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <string_view>
 
 using namespace cs251;
 
-filesystem::filesystem(const size_t sizeLimit) {
+filesystem::filesystem(const size_t sizeLimit, const bool indexChildNames) {
     m_sizeLimit = sizeLimit;
     m_currentSize = 0;
-    m_fileSystemNodes;
-    m_maxHeap;
+    const name_pool* names = m_names.get();
+    m_fileSystemNodes.set_child_key([names](const filesystem_node_data& data) {
+        return names->view(data.m_name);
+    });
+    m_fileSystemNodes.set_child_index_enabled(indexChildNames);
 }
 
-bool filesystem::exist(const handle targetHandle) {
-    for (const tree_node<filesystem_node_data>& node : m_fileSystemNodes.peek_nodes()) {
-        if ((node.get_handle() == targetHandle) && (!node.is_recycled())) {
-            return true;
-        }
-    }
-    return false;
+bool filesystem::exist(const handle targetHandle) const {
+    return m_fileSystemNodes.is_alive(targetHandle);
+}
+
+bool filesystem::exist(const tagged_handle& targetHandle) const {
+    return m_fileSystemNodes.is_alive(targetHandle);
+}
+
+tagged_handle filesystem::get_tagged_handle(const handle targetHandle) const {
+    return m_fileSystemNodes.get_tagged_handle(targetHandle);
 }
 
 handle filesystem::create_file(const size_t fileSize, const std::string& fileName) {
@@ -28,28 +36,24 @@ handle filesystem::create_file(const size_t fileSize, const std::string& fileNam
     if (m_fileSystemNodes.ref_node(parentHandle).ref_data().m_type != node_type::Directory) {
         throw invalid_handle();   
     }
-    for (char c : fileName) {
-        if (c == '/') {
-            throw invalid_name();   
-        }
-    }
+    check_name(fileName);
     if (fileSize > get_available_size()) {
         throw exceeds_size();   
     }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(parentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == fileName) {
-            throw file_exists();
-        }
+    check_quota(parentHandle, fileSize);
+    if (m_fileSystemNodes.find_child(parentHandle, fileName) != -1) {
+        throw file_exists();
     }
 	filesystem_node_data file;
     file.m_type = node_type::File;
-    file.m_name = fileName;
+    file.m_name = m_names->intern(fileName);
     file.m_fileSize = fileSize;
     m_currentSize += fileSize;
-    handle fileHandle = m_fileSystemNodes.allocate(parentHandle);
-    m_fileSystemNodes.ref_node(fileHandle).ref_data() = file;
+    handle fileHandle = m_fileSystemNodes.allocate(parentHandle, file);
+    propagate_usage(parentHandle, get_contribution(fileHandle), true);
     m_maxHeap.push(fileSize, fileHandle);
+    m_sizeIndex.insert(fileSize, fileHandle);
+    log_operation(operation_type::CreateFile, parentHandle, -1, fileSize, fileName);
     return fileHandle;
 }
 
@@ -61,22 +65,16 @@ handle filesystem::create_directory(const std::string& directoryName) {
     if (m_fileSystemNodes.ref_node(parentHandle).ref_data().m_type != node_type::Directory) {
         throw invalid_handle();   
     }
-    for (char c : directoryName) {
-        if (c == '/') {
-            throw invalid_name();   
-        }
-    }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(parentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == directoryName) {
-            throw directory_exists();
-        }
+    check_name(directoryName);
+    if (m_fileSystemNodes.find_child(parentHandle, directoryName) != -1) {
+        throw directory_exists();
     }
 	filesystem_node_data directory;
     directory.m_type = node_type::Directory;
-    directory.m_name = directoryName;
-    handle directoryHandle = m_fileSystemNodes.allocate(parentHandle);
-    m_fileSystemNodes.ref_node(directoryHandle).ref_data() = directory;
+    directory.m_name = m_names->intern(directoryName);
+    handle directoryHandle = m_fileSystemNodes.allocate(parentHandle, directory);
+    propagate_usage(parentHandle, get_contribution(directoryHandle), true);
+    log_operation(operation_type::CreateDirectory, parentHandle, -1, 0, directoryName);
     return directoryHandle;
 }
 
@@ -88,23 +86,18 @@ handle filesystem::create_link(const handle targetHandle, const std::string& lin
     if (m_fileSystemNodes.ref_node(parentHandle).ref_data().m_type != node_type::Directory) {
         throw invalid_handle();   
     }
-    for (char c : linkName) {
-        if (c == '/') {
-            throw invalid_name();   
-        }
-    }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(parentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == linkName) {
-            throw link_exists();
-        }
+    check_name(linkName);
+    if (m_fileSystemNodes.find_child(parentHandle, linkName) != -1) {
+        throw link_exists();
     }
 	filesystem_node_data link;
     link.m_type = node_type::Link;
     link.m_linkedHandle = targetHandle;
-    link.m_name = linkName;
-    handle linkHandle = m_fileSystemNodes.allocate(parentHandle);
-    m_fileSystemNodes.ref_node(linkHandle).ref_data() = link;
+    link.m_name = m_names->intern(linkName);
+    handle linkHandle = m_fileSystemNodes.allocate(parentHandle, link);
+    register_link(linkHandle, targetHandle);
+    propagate_usage(parentHandle, get_contribution(linkHandle), true);
+    log_operation(operation_type::CreateLink, parentHandle, targetHandle, 0, linkName);
     return linkHandle;
 }
 
@@ -120,28 +113,24 @@ handle filesystem::create_file(const size_t fileSize, const std::string& fileNam
     if (m_fileSystemNodes.ref_node(newParentHandle).ref_data().m_type != node_type::Directory) {
         throw invalid_handle();   
     }
-    for (char c : fileName) {
-        if (c == '/') {
-            throw invalid_name();   
-        }
-    }
+    check_name(fileName);
     if (fileSize > get_available_size()) {
         throw exceeds_size();   
     }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(newParentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == fileName) {
-            throw file_exists();
-        }
+    check_quota(newParentHandle, fileSize);
+    if (m_fileSystemNodes.find_child(newParentHandle, fileName) != -1) {
+        throw file_exists();
     }
 	filesystem_node_data file;
     file.m_type = node_type::File;
-    file.m_name = fileName;
+    file.m_name = m_names->intern(fileName);
     file.m_fileSize = fileSize;
     m_currentSize += fileSize;
-    handle fileHandle = m_fileSystemNodes.allocate(newParentHandle);
-    m_fileSystemNodes.ref_node(fileHandle).ref_data() = file;
+    handle fileHandle = m_fileSystemNodes.allocate(newParentHandle, file);
+    propagate_usage(newParentHandle, get_contribution(fileHandle), true);
     m_maxHeap.push(fileSize, fileHandle);
+    m_sizeIndex.insert(fileSize, fileHandle);
+    log_operation(operation_type::CreateFile, newParentHandle, -1, fileSize, fileName);
     return fileHandle;
 }
 
@@ -157,22 +146,16 @@ handle filesystem::create_directory(const std::string& directoryName, const hand
     if (m_fileSystemNodes.ref_node(newParentHandle).ref_data().m_type != node_type::Directory) {
         throw invalid_handle();   
     }
-    for (char c : directoryName) {
-        if (c == '/') {
-            throw invalid_name();   
-        }
-    }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(newParentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == directoryName) {
-            throw directory_exists();
-        }
+    check_name(directoryName);
+    if (m_fileSystemNodes.find_child(newParentHandle, directoryName) != -1) {
+        throw directory_exists();
     }
 	filesystem_node_data directory;
     directory.m_type = node_type::Directory;
-    directory.m_name = directoryName;
-    handle directoryHandle = m_fileSystemNodes.allocate(newParentHandle);
-    m_fileSystemNodes.ref_node(directoryHandle).ref_data() = directory;
+    directory.m_name = m_names->intern(directoryName);
+    handle directoryHandle = m_fileSystemNodes.allocate(newParentHandle, directory);
+    propagate_usage(newParentHandle, get_contribution(directoryHandle), true);
+    log_operation(operation_type::CreateDirectory, newParentHandle, -1, 0, directoryName);
     return directoryHandle;
 }
 
@@ -188,23 +171,18 @@ handle filesystem::create_link(const handle targetHandle, const std::string& lin
     if (m_fileSystemNodes.ref_node(newParentHandle).ref_data().m_type != node_type::Directory) {
         throw invalid_handle();   
     }
-    for (char c : linkName) {
-        if (c == '/') {
-            throw invalid_name();   
-        }
-    }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(newParentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == linkName) {
-            throw link_exists();
-        }
+    check_name(linkName);
+    if (m_fileSystemNodes.find_child(newParentHandle, linkName) != -1) {
+        throw link_exists();
     }
     filesystem_node_data link;
     link.m_type = node_type::Link;
     link.m_linkedHandle = targetHandle;
-    link.m_name = linkName;
-    handle linkHandle = m_fileSystemNodes.allocate(newParentHandle);
-    m_fileSystemNodes.ref_node(linkHandle).ref_data() = link;
+    link.m_name = m_names->intern(linkName);
+    handle linkHandle = m_fileSystemNodes.allocate(newParentHandle, link);
+    register_link(linkHandle, targetHandle);
+    propagate_usage(newParentHandle, get_contribution(linkHandle), true);
+    log_operation(operation_type::CreateLink, newParentHandle, targetHandle, 0, linkName);
     return linkHandle;
 }
 
@@ -214,146 +192,609 @@ bool filesystem::remove(const handle targetHandle) {
     }
     node_type type = m_fileSystemNodes.ref_node(targetHandle).ref_data().m_type;
     if (type == node_type::Directory) {
-        if (m_fileSystemNodes.ref_node(targetHandle).peek_children_handles().empty()) {
+        if (m_fileSystemNodes.ref_node(targetHandle).get_child_count() == 0) {
+            propagate_usage(m_fileSystemNodes.get_parent(targetHandle), get_contribution(targetHandle), false);
+            if (m_fileSystemNodes.ref_node(targetHandle).ref_data().m_quota != static_cast<size_t>(-1)) {
+                m_quotaCount -= 1;
+            }
             m_fileSystemNodes.remove(targetHandle);
+            detach_links(targetHandle);
+            invalidate_paths();
+            log_operation(operation_type::Remove, targetHandle);
             return true;
         }
         return false;  
     }
+    propagate_usage(m_fileSystemNodes.get_parent(targetHandle), get_contribution(targetHandle), false);
     if (type == node_type::File) {
-        m_currentSize -= m_fileSystemNodes.ref_node(targetHandle).ref_data().m_fileSize;
+        size_t fileSize = m_fileSystemNodes.ref_node(targetHandle).ref_data().m_fileSize;
+        m_currentSize -= fileSize;
         m_maxHeap.remove(targetHandle);
+        m_sizeIndex.remove(fileSize, targetHandle);
     }
     m_fileSystemNodes.remove(targetHandle);
+    if (type == node_type::Link) {
+        unregister_link(targetHandle);
+    }
+    detach_links(targetHandle);
+    if (type == node_type::Link) {
+        // Paths through the link no longer resolve, and their targets are still alive.
+        invalidate_paths();
+        invalidate_links();
+    }
+    log_operation(operation_type::Remove, targetHandle);
     return true;    
 }
 
-void filesystem::rename(const handle targetHandle, const std::string& newName) {
-	if (!exist(targetHandle) || targetHandle == 0) {
-        throw invalid_handle();    
+size_t filesystem::remove_recursive(const handle targetHandle) {
+    if (!exist(targetHandle) || targetHandle == 0) {
+        throw invalid_handle();
     }
-    for (char c : newName) {
-        if (c == '/') {
-            throw invalid_name();   
+    directory_usage contribution = get_contribution(targetHandle);
+    propagate_usage(m_fileSystemNodes.get_parent(targetHandle), contribution, false);
+    m_currentSize -= contribution.m_bytes;
+    std::vector<handle> freed = m_fileSystemNodes.remove(targetHandle);
+    std::vector<handle> files;
+    for (handle h : freed) {
+        const filesystem_node_data& data = m_fileSystemNodes.peek_nodes()[h].peek_data();
+        if (data.m_type == node_type::File) {
+            files.push_back(h);
+            m_sizeIndex.remove(data.m_fileSize, h);
+        } else if ((data.m_type == node_type::Directory) && (data.m_quota != static_cast<size_t>(-1))) {
+            m_quotaCount -= 1;
         }
     }
-    handle parentHandle = m_fileSystemNodes.ref_node(targetHandle).get_parent_handle();
-    std::vector<handle> children = m_fileSystemNodes.ref_node(parentHandle).peek_children_handles();
-    for (handle h : children) {
-        if (get_name(h) == newName) {
-            throw name_exists();
+    m_maxHeap.remove_all(files);
+    // Forget the removed links first, so only live links are left dangling.
+    for (handle h : freed) {
+        if (m_fileSystemNodes.peek_nodes()[h].peek_data().m_type == node_type::Link) {
+            unregister_link(h);
         }
     }
-    m_fileSystemNodes.ref_node(targetHandle).ref_data().m_name = newName;
+    for (handle h : freed) {
+        detach_links(h);
+    }
+    invalidate_paths();
+    invalidate_links();
+    log_operation(operation_type::RemoveRecursive, targetHandle);
+    return freed.size();
 }
 
-std::string filesystem::get_absolute_path(const handle targetHandle) {
+void filesystem::resize_file(const handle targetHandle, const size_t newSize) {
     if (!exist(targetHandle)) {
-        throw invalid_handle();    
+        throw invalid_handle();
     }
-    std::string absolutePath = "";
-    handle currentHandle = targetHandle;
-    while (currentHandle != 0) {
-        if (!absolutePath.empty()) {
-            absolutePath = "/" + absolutePath;
+    handle fileHandle = follow(targetHandle);
+    filesystem_node_data& file = m_fileSystemNodes.ref_node(fileHandle).ref_data();
+    if (file.m_type != node_type::File) {
+        throw invalid_handle();
+    }
+    if ((newSize > file.m_fileSize) && (newSize - file.m_fileSize > get_available_size())) {
+        throw exceeds_size();
+    }
+    if (newSize > file.m_fileSize) {
+        check_quota(m_fileSystemNodes.get_parent(fileHandle), newSize - file.m_fileSize);
+    }
+    directory_usage difference;
+    difference.m_bytes = newSize > file.m_fileSize ? newSize - file.m_fileSize : file.m_fileSize - newSize;
+    propagate_usage(m_fileSystemNodes.get_parent(fileHandle), difference, newSize > file.m_fileSize);
+    m_currentSize = m_currentSize - file.m_fileSize + newSize;
+    m_sizeIndex.remove(file.m_fileSize, fileHandle);
+    m_sizeIndex.insert(newSize, fileHandle);
+    file.m_fileSize = newSize;
+    m_maxHeap.update(fileHandle, newSize);
+    log_operation(operation_type::ResizeFile, fileHandle, -1, newSize);
+}
+
+void filesystem::move(const handle targetHandle, const handle parentHandle) {
+    if (!exist(targetHandle) || targetHandle == 0 || !exist(parentHandle)) {
+        throw invalid_handle();
+    }
+    handle newParentHandle = follow(parentHandle);
+    if (m_fileSystemNodes.ref_node(newParentHandle).ref_data().m_type != node_type::Directory) {
+        throw invalid_handle();
+    }
+    for (handle h = newParentHandle; h != -1; h = m_fileSystemNodes.get_parent(h)) {
+        if (h == targetHandle) {
+            throw invalid_handle();
         }
-        std::string currentName = get_name(currentHandle);
-        absolutePath = currentName + absolutePath;
-        currentHandle = m_fileSystemNodes.ref_node(currentHandle).get_parent_handle();
     }
-    absolutePath = "/" + absolutePath;
+    handle oldParentHandle = m_fileSystemNodes.get_parent(targetHandle);
+    if (oldParentHandle == newParentHandle) {
+        return;
+    }
+    if (m_fileSystemNodes.find_child(newParentHandle, m_names->view(m_fileSystemNodes.ref_node(targetHandle).ref_data().m_name)) != -1) {
+        throw name_exists();
+    }
+    directory_usage contribution = get_contribution(targetHandle);
+    if (m_quotaCount > 0) {
+        // Directories above both locations do not grow, so only check up to the closest common ancestor.
+        size_t newDepth = m_fileSystemNodes.get_depth(newParentHandle);
+        size_t oldDepth = m_fileSystemNodes.get_depth(oldParentHandle);
+        handle commonHandle = newParentHandle;
+        handle oldAncestorHandle = oldParentHandle;
+        for (; newDepth > oldDepth; newDepth--) {
+            commonHandle = m_fileSystemNodes.get_parent(commonHandle);
+        }
+        for (; oldDepth > newDepth; oldDepth--) {
+            oldAncestorHandle = m_fileSystemNodes.get_parent(oldAncestorHandle);
+        }
+        while (commonHandle != oldAncestorHandle) {
+            commonHandle = m_fileSystemNodes.get_parent(commonHandle);
+            oldAncestorHandle = m_fileSystemNodes.get_parent(oldAncestorHandle);
+        }
+        check_quota(newParentHandle, contribution.m_bytes, commonHandle);
+    }
+    propagate_usage(oldParentHandle, contribution, false);
+    m_fileSystemNodes.set_parent(targetHandle, newParentHandle);
+    propagate_usage(newParentHandle, contribution, true);
+    invalidate_paths();
+    log_operation(operation_type::Move, targetHandle, newParentHandle);
+}
+
+void filesystem::set_quota(const handle targetHandle, const size_t quota) {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    filesystem_node_data& directory = m_fileSystemNodes.ref_node(follow(targetHandle)).ref_data();
+    if (directory.m_type != node_type::Directory) {
+        throw invalid_handle();
+    }
+    if (directory.m_usage.m_bytes > quota) {
+        throw exceeds_quota();
+    }
+    if (directory.m_quota == static_cast<size_t>(-1)) {
+        m_quotaCount += 1;
+    }
+    if (quota == static_cast<size_t>(-1)) {
+        m_quotaCount -= 1;
+    }
+    directory.m_quota = quota;
+    log_operation(operation_type::SetQuota, targetHandle, -1, quota);
+}
+
+size_t filesystem::get_quota(const handle targetHandle) {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    const filesystem_node_data& directory = m_fileSystemNodes.ref_node(follow(targetHandle)).ref_data();
+    if (directory.m_type != node_type::Directory) {
+        throw invalid_handle();
+    }
+    return directory.m_quota;
+}
+
+void filesystem::check_name(const std::string_view name) {
+    // "." and ".." navigate while a path is resolved, so an entry named like that could never be reached by its path.
+    if (name.empty() || (name == ".") || (name == "..") || (name.find('/') != std::string_view::npos)) {
+        throw invalid_name();
+    }
+}
+
+void filesystem::check_quota(const handle directoryHandle, const size_t bytes, const handle stopHandle) {
+    if (m_quotaCount == 0 || bytes == 0) {
+        return;
+    }
+    for (handle h = directoryHandle; h != stopHandle; h = m_fileSystemNodes.get_parent(h)) {
+        const filesystem_node_data& directory = m_fileSystemNodes.ref_node(h).ref_data();
+        if (bytes > directory.m_quota - directory.m_usage.m_bytes) {
+            throw exceeds_quota();
+        }
+    }
+}
+
+size_t filesystem::get_directory_size(const handle targetHandle) {
+    return get_directory_usage(targetHandle).m_bytes;
+}
+
+directory_usage filesystem::get_directory_usage(const handle targetHandle) {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    const filesystem_node_data& directory = m_fileSystemNodes.ref_node(follow(targetHandle)).ref_data();
+    if (directory.m_type != node_type::Directory) {
+        throw invalid_handle();
+    }
+    return directory.m_usage;
+}
+
+directory_usage filesystem::get_contribution(const handle targetHandle) {
+    const filesystem_node_data& data = m_fileSystemNodes.ref_node(targetHandle).ref_data();
+    directory_usage usage;
+    switch (data.m_type)
+    {
+    case node_type::Directory:
+        usage = data.m_usage;
+        usage.m_directoryCount += 1;
+        break;
+    case node_type::File:
+        usage.m_bytes = data.m_fileSize;
+        usage.m_fileCount = 1;
+        break;
+    case node_type::Link:
+        usage.m_linkCount = 1;
+        break;
+    }
+    return usage;
+}
+
+void filesystem::propagate_usage(const handle directoryHandle, const directory_usage& usage, const bool add) {
+    for (handle h = directoryHandle; h != -1; h = m_fileSystemNodes.get_parent(h)) {
+        directory_usage& total = m_fileSystemNodes.ref_node(h).ref_data().m_usage;
+        if (add) {
+            total.m_bytes += usage.m_bytes;
+            total.m_fileCount += usage.m_fileCount;
+            total.m_directoryCount += usage.m_directoryCount;
+            total.m_linkCount += usage.m_linkCount;
+        } else {
+            total.m_bytes -= usage.m_bytes;
+            total.m_fileCount -= usage.m_fileCount;
+            total.m_directoryCount -= usage.m_directoryCount;
+            total.m_linkCount -= usage.m_linkCount;
+        }
+    }
+}
+
+void filesystem::rename(const handle targetHandle, const std::string& newName) {
+	if (!exist(targetHandle) || targetHandle == 0) {
+        throw invalid_handle();    
+    }
+    check_name(newName);
+    handle parentHandle = m_fileSystemNodes.get_parent(targetHandle);
+    if (m_fileSystemNodes.find_child(parentHandle, newName) != -1) {
+        throw name_exists();
+    }
+    name_id oldName = m_fileSystemNodes.ref_node(targetHandle).ref_data().m_name;
+    m_fileSystemNodes.ref_node(targetHandle).ref_data().m_name = m_names->intern(newName);
+    m_fileSystemNodes.reindex_child(targetHandle, m_names->view(oldName));
+    invalidate_paths();
+    log_operation(operation_type::Rename, targetHandle, -1, 0, newName);
+}
+
+std::string filesystem::get_absolute_path(const handle targetHandle) {
+    std::string absolutePath;
+    get_absolute_path(targetHandle, absolutePath);
     return absolutePath;
 }
 
+void filesystem::get_absolute_path(const handle targetHandle, std::string& absolutePath) {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();    
+    }
+    absolutePath.clear();
+    if (targetHandle == 0) {
+        absolutePath += '/';
+        return;
+    }
+    const handle parentHandle = m_fileSystemNodes.get_parent(targetHandle);
+    const std::string_view name = peek_name(targetHandle);
+    if (m_parentPathCacheEnabled && (parentHandle != 0) && (m_parentPathEpoch == m_pathEpoch)
+        && (m_parentPathHandle.m_handle == parentHandle) && m_fileSystemNodes.is_alive(m_parentPathHandle)) {
+        absolutePath.reserve(m_parentPath.size() + 1 + name.size());
+        absolutePath += m_parentPath;
+        absolutePath += '/';
+        absolutePath += name;
+        return;
+    }
+    m_pathScratch.clear();
+    size_t length = 0;
+    for (handle currentHandle = targetHandle; currentHandle != 0; currentHandle = m_fileSystemNodes.get_parent(currentHandle)) {
+        m_pathScratch.push_back(currentHandle);
+        length += 1 + peek_name(currentHandle).size();
+    }
+    absolutePath.reserve(length);
+    for (auto it = m_pathScratch.rbegin(); it != m_pathScratch.rend(); ++it) {
+        absolutePath += '/';
+        absolutePath += peek_name(*it);
+    }
+    if (m_parentPathCacheEnabled && (parentHandle != 0)) {
+        m_parentPath.assign(absolutePath, 0, length - 1 - name.size());
+        m_parentPathHandle = m_fileSystemNodes.get_tagged_handle(parentHandle);
+        m_parentPathEpoch = m_pathEpoch;
+    }
+}
+
+void filesystem::set_parent_path_cache_enabled(const bool enabled) {
+    m_parentPathCacheEnabled = enabled;
+    m_parentPathHandle = tagged_handle();
+}
+
 std::string filesystem::get_name(const handle targetHandle) {
 	if (!exist(targetHandle)) {
         throw invalid_handle();    
     }
-    return m_fileSystemNodes.ref_node(targetHandle).ref_data().m_name;
+    return std::string(peek_name(targetHandle));
+}
+
+std::string_view filesystem::peek_name(const handle targetHandle) const {
+    if (!m_fileSystemNodes.is_alive(targetHandle)) {
+        throw invalid_handle();
+    }
+    return m_names->view(m_fileSystemNodes.peek_nodes()[targetHandle].peek_data().m_name);
 }
 
 handle filesystem::get_handle(const std::string& absolutePath) {
-    if (absolutePath == "/") {
-        return 0;
+    return resolve(absolutePath, 0);
+}
+
+handle filesystem::resolve(const std::string_view path, const handle startHandle) {
+    if (m_pathCache.empty() || path.empty() || (path[0] != '/')) {
+        return resolve_uncached(path, startHandle);
+    }
+    path_cache_entry& entry = m_pathCache[std::hash<std::string_view>()(path) & (m_pathCache.size() - 1)];
+    if ((entry.m_epoch == m_pathEpoch) && (entry.m_path == path) && m_fileSystemNodes.is_alive(entry.m_target)) {
+        m_pathCacheHits += 1;
+        return entry.m_target.m_handle;
     }
-    std::string path = absolutePath;
-    path.erase(0, 1);
+    m_pathCacheMisses += 1;
+    const handle targetHandle = resolve_uncached(path, startHandle);
+    entry.m_path.assign(path.data(), path.size());
+    entry.m_target = m_fileSystemNodes.get_tagged_handle(targetHandle);
+    entry.m_epoch = m_pathEpoch;
+    return targetHandle;
+}
+
+void filesystem::reserve(const size_t nodeCount) {
+    m_fileSystemNodes.reserve(nodeCount);
+    m_linkMemos.reserve(nodeCount);
+}
+
+void filesystem::set_pool_policy(const pool_policy policy) {
+    // The tree rejects values outside the enum before this logs them.
+    m_fileSystemNodes.set_pool_policy(policy);
+    // The policy decides which handles later creates get, so replaying them needs it too.
+    log_operation(operation_type::SetPoolPolicy, -1, -1, static_cast<size_t>(policy));
+}
+
+std::vector<handle> filesystem::compact() {
+    std::vector<handle> remap = m_fileSystemNodes.compact();
+    std::vector<file_size_max_heap_node> files;
+    std::vector<std::pair<size_t, handle>> sizes;
+    std::unordered_map<handle, std::vector<handle>> linksTo;
+    // The pool only grows, so the names of removed and renamed nodes are dropped by interning the live ones again.
+    std::unique_ptr<name_pool> namePool = std::make_unique<name_pool>();
+    for (handle h = 0; h < static_cast<handle>(m_fileSystemNodes.peek_nodes().size()); h++) {
+        filesystem_node_data& data = m_fileSystemNodes.ref_node(h).ref_data();
+        data.m_name = namePool->intern(m_names->view(data.m_name));
+        if (data.m_type == node_type::File) {
+            file_size_max_heap_node file;
+            file.m_handle = h;
+            file.m_value = data.m_fileSize;
+            files.push_back(file);
+            sizes.emplace_back(data.m_fileSize, h);
+        } else if ((data.m_type == node_type::Link) && (data.m_linkedHandle != -1)) {
+            data.m_linkedHandle = remap[data.m_linkedHandle];
+            linksTo[data.m_linkedHandle].push_back(h);
+        }
+    }
+    file_size_max_heap maxHeap;
+    maxHeap.push_all(files);
+    file_size_index sizeIndex;
+    sizeIndex.insert_all(std::move(sizes));
+    m_maxHeap = std::move(maxHeap);
+    m_sizeIndex = std::move(sizeIndex);
+    m_linksTo = std::move(linksTo);
+    // The child index is keyed by views into the pool, so it is rebuilt before the old pool is released.
+    const name_pool* names = namePool.get();
+    m_fileSystemNodes.set_child_key([names](const filesystem_node_data& data) {
+        return names->view(data.m_name);
+    });
+    m_names = std::move(namePool);
+    m_linkMemos.clear();
+    invalidate_paths();
+    invalidate_links();
+    if (m_log) {
+        checkpoint();
+    }
+    return remap;
+}
+
+double filesystem::get_fragmentation() const {
+    return m_fileSystemNodes.get_fragmentation();
+}
+
+void filesystem::set_path_cache_capacity(const size_t entries) {
+    size_t capacity = 0;
+    if (entries > 0) {
+        capacity = 1;
+        while (capacity < entries) {
+            capacity *= 2;
+        }
+    }
+    m_pathCache.assign(capacity, path_cache_entry());
+}
+
+size_t filesystem::get_path_cache_hits() const {
+    return m_pathCacheHits;
+}
+
+size_t filesystem::get_path_cache_misses() const {
+    return m_pathCacheMisses;
+}
+
+void filesystem::invalidate_paths() {
+    m_pathEpoch += 1;
+}
+
+template <typename follow_function>
+handle filesystem::walk_path(const std::string_view path, const handle startHandle, follow_function followLink) const {
+    const auto& nodes = m_fileSystemNodes.peek_nodes();
     handle currentHandle = 0;
-    std::string name = "";
-    for (char c : path) {
-        if (c != '/') {
-            name += c;
+    size_t begin = 0;
+    if (!path.empty() && (path[0] == '/')) {
+        if (path.size() == 1) {
+            return 0;
+        }
+        begin = 1;
+    } else {
+        if (!exist(startHandle)) {
+            throw invalid_handle();
+        }
+        currentHandle = followLink(startHandle);
+        if (nodes[currentHandle].peek_data().m_type != node_type::Directory) {
+            throw invalid_path();
+        }
+    }
+    while (true) {
+        const size_t end = path.find('/', begin);
+        const std::string_view name = path.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+        handle childHandle;
+        if (name == ".") {
+            childHandle = currentHandle;
+        } else if (name == "..") {
+            childHandle = currentHandle == 0 ? 0 : m_fileSystemNodes.get_parent(currentHandle);
         } else {
-            std::vector<handle> children = m_fileSystemNodes.ref_node(currentHandle).peek_children_handles();
-            bool exist = false;
-            handle childHandle;
-            for (handle h : children) {
-                if (get_name(h) == name) {
-                    exist = true;
-                    childHandle = h;
-                    break;
-                }
-            }
-            if (!exist) {
-                throw invalid_path();
-            }
-            node_type type = m_fileSystemNodes.ref_node(childHandle).ref_data().m_type;
-            if (type == node_type::Link) {
-                currentHandle = follow(childHandle);
-            } else if (type == node_type::Directory) {
-                currentHandle = childHandle;
-            } else {
+            childHandle = m_fileSystemNodes.find_child(currentHandle, name);
+            if (childHandle == -1) {
                 throw invalid_path();
             }
-            name.clear();
         }
-    }
-    std::vector<handle> children = m_fileSystemNodes.ref_node(currentHandle).peek_children_handles();
-    bool exist = false;
-    handle childHandle;
-    for (handle h : children) {
-        if (get_name(h) == name) {
-            childHandle = h;
-            exist = true;
-            break;
+        if (end == std::string_view::npos) {
+            return childHandle;
         }
+        currentHandle = followLink(childHandle);
+        if (nodes[currentHandle].peek_data().m_type != node_type::Directory) {
+            throw invalid_path();
+        }
+        begin = end + 1;
     }
-    if (!exist) {
-        throw invalid_path();
-    }
-    return childHandle;
+}
+
+handle filesystem::resolve_uncached(const std::string_view path, const handle startHandle) {
+    return walk_path(path, startHandle, [this](const handle targetHandle) { return follow(targetHandle); });
+}
+
+handle filesystem::peek_handle(const std::string_view path, const handle startHandle) const {
+    return walk_path(path, startHandle, [this](const handle targetHandle) { return peek_follow(targetHandle); });
 }
 
 handle filesystem::follow(const handle targetHandle) {
     if (!exist(targetHandle)) {
         throw invalid_handle();    
     }
-    node_type type = m_fileSystemNodes.ref_node(targetHandle).ref_data().m_type;
-    if (type != node_type::Link) {
+    if (m_fileSystemNodes.ref_node(targetHandle).ref_data().m_type != node_type::Link) {
         return targetHandle;    
     }
-    handle linkedHandle = m_fileSystemNodes.ref_node(targetHandle).ref_data().m_linkedHandle;
-    return follow(linkedHandle);    
+    if (m_linkMemos.size() < m_fileSystemNodes.peek_nodes().size()) {
+        m_linkMemos.resize(m_fileSystemNodes.peek_nodes().size());
+    }
+    handle currentHandle = targetHandle;
+    for (size_t hops = 0; ; hops++) {
+        const link_memo& memo = m_linkMemos[currentHandle];
+        if ((memo.m_epoch == m_linkEpoch) && m_fileSystemNodes.is_alive(memo.m_target)) {
+            currentHandle = memo.m_target.m_handle;
+            break;
+        }
+        if (hops == max_link_hops) {
+            throw link_cycle();
+        }
+        currentHandle = m_fileSystemNodes.ref_node(currentHandle).ref_data().m_linkedHandle;
+        if (!exist(currentHandle)) {
+            throw invalid_handle();
+        }
+        if (m_fileSystemNodes.ref_node(currentHandle).ref_data().m_type != node_type::Link) {
+            break;
+        }
+    }
+    link_memo& memo = m_linkMemos[targetHandle];
+    memo.m_target = m_fileSystemNodes.get_tagged_handle(currentHandle);
+    memo.m_epoch = m_linkEpoch;
+    return currentHandle;
+}
+
+handle filesystem::peek_follow(const handle targetHandle) const {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    const auto& nodes = m_fileSystemNodes.peek_nodes();
+    handle currentHandle = targetHandle;
+    for (size_t hops = 0; nodes[currentHandle].peek_data().m_type == node_type::Link; hops++) {
+        if (hops == max_link_hops) {
+            throw link_cycle();
+        }
+        currentHandle = nodes[currentHandle].peek_data().m_linkedHandle;
+        if (!exist(currentHandle)) {
+            throw invalid_handle();
+        }
+    }
+    return currentHandle;
+}
+
+void filesystem::invalidate_links() {
+    m_linkEpoch += 1;
+}
+
+std::vector<handle> filesystem::get_links_to(const handle targetHandle) {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    auto it = m_linksTo.find(targetHandle);
+    return it == m_linksTo.end() ? std::vector<handle>() : it->second;
+}
+
+void filesystem::register_link(const handle linkHandle, const handle targetHandle) {
+    m_linksTo[targetHandle].push_back(linkHandle);
+}
+
+void filesystem::unregister_link(const handle linkHandle) {
+    const handle targetHandle = m_fileSystemNodes.peek_nodes()[linkHandle].peek_data().m_linkedHandle;
+    auto it = m_linksTo.find(targetHandle);
+    if (it == m_linksTo.end()) {
+        return;
+    }
+    std::vector<handle>& links = it->second;
+    links.erase(std::find(links.begin(), links.end(), linkHandle));
+    if (links.empty()) {
+        m_linksTo.erase(it);
+    }
+}
+
+void filesystem::detach_links(const handle targetHandle) {
+    auto it = m_linksTo.find(targetHandle);
+    if (it == m_linksTo.end()) {
+        return;
+    }
+    for (handle linkHandle : it->second) {
+        m_fileSystemNodes.ref_node(linkHandle).ref_data().m_linkedHandle = -1;
+    }
+    m_linksTo.erase(it);
 }
 
 size_t filesystem::get_available_size() const {
 	return m_sizeLimit - m_currentSize;
 }
 
+node_type filesystem::get_type(const handle targetHandle) const {
+    if (!exist(targetHandle)) {
+        throw invalid_handle();
+    }
+    return m_fileSystemNodes.peek_nodes()[targetHandle].peek_data().m_type;
+}
+
+handle filesystem::get_parent(const handle targetHandle) const {
+    if (!exist(targetHandle) || targetHandle == 0) {
+        throw invalid_handle();
+    }
+    return m_fileSystemNodes.get_parent(targetHandle);
+}
+
 size_t filesystem::get_file_size(const handle targetHandle) {
 	if (!exist(targetHandle)) {
         throw invalid_handle();    
     }
-    node_type type = m_fileSystemNodes.ref_node(targetHandle).ref_data().m_type;
-    if (type == node_type::File) {
-        return m_fileSystemNodes.ref_node(targetHandle).ref_data().m_fileSize;    
-    }
-    if (type == node_type::Directory) {
+    const filesystem_node_data& file = m_fileSystemNodes.ref_node(follow(targetHandle)).ref_data();
+    if (file.m_type != node_type::File) {
         throw invalid_handle();
     }
-    if (type == node_type::Link) {
-        get_file_size(m_fileSystemNodes.ref_node(targetHandle).ref_data().m_linkedHandle);
+    return file.m_fileSize;
+}
+
+size_t filesystem::peek_file_size(const handle targetHandle) const {
+    const filesystem_node_data& data = m_fileSystemNodes.peek_nodes()[peek_follow(targetHandle)].peek_data();
+    if (data.m_type != node_type::File) {
+        throw invalid_handle();
     }
+    return data.m_fileSize;
 }
 
 size_t filesystem::get_file_size(const std::string& absolutePath) {
@@ -362,50 +803,233 @@ size_t filesystem::get_file_size(const std::string& absolutePath) {
 
 std::string filesystem::print_layout() {
 	std::stringstream ss{};
-	const auto& node = m_fileSystemNodes.ref_node(0);
-	for (const auto& childHandle : node.peek_children_handles()) {
-		print_traverse(0, ss, childHandle);
-	}
+	print_layout(ss, layout_options{});
 	return ss.str();
 }
 
-void filesystem::print_traverse(const size_t level, std::stringstream& ss, const handle targetHandle) {
-	auto& node = m_fileSystemNodes.ref_node(targetHandle);
-	std::stringstream indentation{};
-	for (auto i = level; i > 0; i--)
-	{
-		indentation << "\t";
+size_t filesystem::print_layout(std::ostream& out, const layout_options& options) {
+	if (!exist(options.m_root)) {
+		throw invalid_handle();
+	}
+	const handle rootHandle = follow(options.m_root);
+	const auto& nodes = m_fileSystemNodes.peek_nodes();
+	if (nodes[rootHandle].peek_data().m_type != node_type::Directory) {
+		throw invalid_handle();
+	}
+	if ((options.m_maxDepth == 0) || (options.m_maxEntries == 0)) {
+		return 0;
+	}
+	std::string indentation{};
+	std::string linkPath{};
+	size_t skipped = 0;
+	size_t written = 0;
+	// Print an entry unless it is skipped, and tell if the entry limit is reached.
+	const auto emit = [&](const handle targetHandle) {
+		if (skipped < options.m_skipEntries) {
+			skipped++;
+			return false;
+		}
+		print_entry(out, indentation, targetHandle, linkPath);
+		written++;
+		return written == options.m_maxEntries;
+	};
+	if (m_fileSystemNodes.is_preorder_layout()) {
+		// After compact a subtree is the range of handles following its root, so the walk is a linear sweep
+		// that jumps over the subtrees below the depth limit. ends holds the end of every open level.
+		std::vector<handle> ends{};
+		const handle end = m_fileSystemNodes.get_subtree_end(rootHandle);
+		handle current = rootHandle + 1;
+		while (current < end) {
+			while (!ends.empty() && (current >= ends.back())) {
+				ends.pop_back();
+				indentation.pop_back();
+			}
+			if (emit(current)) {
+				break;
+			}
+			const handle subtreeEnd = m_fileSystemNodes.get_subtree_end(current);
+			if ((subtreeEnd > current + 1) && (indentation.size() + 1 < options.m_maxDepth)) {
+				ends.push_back(subtreeEnd);
+				indentation.push_back('\t');
+				current++;
+			} else {
+				current = subtreeEnd;
+			}
+		}
+		return written;
+	}
+	handle current = nodes[rootHandle].get_first_child_handle();
+	while (current != -1) {
+		if (emit(current)) {
+			break;
+		}
+		// Preorder without a stack: descend to the first child, otherwise climb until an ancestor has a next sibling.
+		const handle firstChild = nodes[current].get_first_child_handle();
+		if ((firstChild != -1) && (indentation.size() + 1 < options.m_maxDepth)) {
+			indentation.push_back('\t');
+			current = firstChild;
+			continue;
+		}
+		handle next = nodes[current].get_next_sibling_handle();
+		while ((next == -1) && !indentation.empty()) {
+			current = nodes[current].get_parent_handle();
+			indentation.pop_back();
+			next = nodes[current].get_next_sibling_handle();
+		}
+		current = next;
 	}
-	std::string type{};
-	switch (node.ref_data().m_type)
+	return written;
+}
+
+void filesystem::print_entry(std::ostream& out, const std::string& indentation, const handle targetHandle, std::string& linkPath) {
+	const filesystem_node_data& data = m_fileSystemNodes.peek_nodes()[targetHandle].peek_data();
+	const char* type = "";
+	switch (data.m_type)
 	{
 	case node_type::Directory: type = "[D]"; break;
 	case node_type::Link: type = "[L]"; break;
 	case node_type::File: type = "[F]"; break;
 	}
-	ss << indentation.str() << type << node.ref_data().m_name;
-	if (node.ref_data().m_type == node_type::Link)
+	out << indentation << type << m_names->view(data.m_name);
+	if (data.m_type == node_type::Link)
 	{
 		try {
-			const auto path = get_absolute_path(follow(node.get_handle()));
-			ss << " [->" << path << "]";
+			get_absolute_path(follow(targetHandle), linkPath);
+			out << " [->" << linkPath << "]";
 		}
 		catch (const std::exception& e)
 		{
-			ss << " [invalid]";
+			out << " [invalid]";
 		}
 	}
-	else if (node.ref_data().m_type == node_type::File)
+	else if (data.m_type == node_type::File)
 	{
-		ss << " (size = " << std::to_string(node.ref_data().m_fileSize) << ")";
-	}
-	ss << std::endl;
-	for (const auto& childHandle : node.peek_children_handles())
-	{
-		print_traverse(level + 1, ss, childHandle);
+		out << " (size = " << data.m_fileSize << ")";
 	}
+	out << '\n';
+}
+
+void filesystem::load_manifest(const std::vector<manifest_entry>& entries) {
+    if (m_fileSystemNodes.ref_node(0).get_child_count() != 0) {
+        throw filesystem_not_empty();
+    }
+    std::vector<handle> created;
+    std::vector<file_size_max_heap_node> files;
+    size_t totalSize = 0;
+    created.reserve(entries.size());
+    try {
+        // Directories by path, viewing into the manifest; the root's children have an empty parent path.
+        std::unordered_map<std::string_view, handle> directories;
+        directories.reserve(entries.size());
+        directories.emplace(std::string_view(), 0);
+        for (const manifest_entry& entry : entries) {
+            const std::string_view path = entry.m_path;
+            const size_t slash = path.rfind('/');
+            if (path.empty() || path[0] != '/' || slash == path.size() - 1) {
+                throw invalid_path();
+            }
+            auto parent = directories.find(path.substr(0, slash));
+            if (parent == directories.end()) {
+                throw invalid_path();
+            }
+            check_name(path.substr(slash + 1));
+            filesystem_node_data data;
+            data.m_type = entry.m_type;
+            data.m_name = m_names->intern(path.substr(slash + 1));
+            if (m_fileSystemNodes.find_child(parent->second, m_names->view(data.m_name)) != -1) {
+                switch (entry.m_type)
+                {
+                case node_type::Directory: throw directory_exists();
+                case node_type::File: throw file_exists();
+                case node_type::Link: throw link_exists();
+                }
+            }
+            if (entry.m_type == node_type::File) {
+                if (entry.m_fileSize > get_available_size() - totalSize) {
+                    throw exceeds_size();
+                }
+                data.m_fileSize = entry.m_fileSize;
+                totalSize += entry.m_fileSize;
+            }
+            handle h = m_fileSystemNodes.allocate(parent->second, data);
+            created.push_back(h);
+            if (entry.m_type == node_type::Directory) {
+                directories.emplace(path, h);
+            } else if (entry.m_type == node_type::File) {
+                file_size_max_heap_node file;
+                file.m_handle = h;
+                file.m_value = entry.m_fileSize;
+                files.push_back(file);
+            }
+        }
+        check_quota(0, totalSize);
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].m_type == node_type::Link) {
+                const handle linkedHandle = get_handle(entries[i].m_linkTarget);
+                m_fileSystemNodes.ref_node(created[i]).ref_data().m_linkedHandle = linkedHandle;
+                register_link(created[i], linkedHandle);
+            }
+        }
+        // A link can name itself or another manifest link, which create_link can never do; reject the cycles here.
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].m_type == node_type::Link) {
+                follow(created[i]);
+            }
+        }
+    } catch (...) {
+        std::vector<handle> children;
+        for (handle h : m_fileSystemNodes.peek_children(0)) {
+            children.push_back(h);
+        }
+        for (handle h : children) {
+            m_fileSystemNodes.remove(h);
+        }
+        m_linksTo.clear();
+        invalidate_paths();
+        invalidate_links();
+        if (m_log) {
+            // The rollback recycled handles and bumped generations without logging it, so the log alone could no longer
+            // replay the handles later operations get.
+            checkpoint();
+        }
+        throw;
+    }
+    // Parents come before their children, so walking backwards folds each subtree's usage into its parent once.
+    for (size_t i = created.size(); i > 0; i--) {
+        handle h = created[i - 1];
+        directory_usage contribution = get_contribution(h);
+        directory_usage& parentUsage = m_fileSystemNodes.ref_node(m_fileSystemNodes.get_parent(h)).ref_data().m_usage;
+        parentUsage.m_bytes += contribution.m_bytes;
+        parentUsage.m_fileCount += contribution.m_fileCount;
+        parentUsage.m_directoryCount += contribution.m_directoryCount;
+        parentUsage.m_linkCount += contribution.m_linkCount;
+    }
+    m_currentSize += totalSize;
+    m_maxHeap.push_all(files);
+    std::vector<std::pair<size_t, handle>> sizes;
+    sizes.reserve(files.size());
+    for (const file_size_max_heap_node& file : files) {
+        sizes.emplace_back(file.m_value, file.m_handle);
+    }
+    m_sizeIndex.insert_all(std::move(sizes));
+    if (m_log) {
+        // A checkpoint is cheaper to recover from than one logged create per entry.
+        checkpoint();
+    }
 }
 
 handle filesystem::get_largest_file_handle() const {
     return m_maxHeap.top();
-}
\ No newline at end of file
+}
+
+std::vector<handle> filesystem::get_largest_files(const size_t k) const {
+    return m_maxHeap.top_k(k);
+}
+
+size_t filesystem::count_files_in_range(const size_t minSize, const size_t maxSize) const {
+    return m_sizeIndex.count_in_range(minSize, maxSize);
+}
+
+size_t filesystem::get_bytes_in_range(const size_t minSize, const size_t maxSize) const {
+    return m_sizeIndex.bytes_in_range(minSize, maxSize);
+}
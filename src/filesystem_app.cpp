@@ -79,6 +79,11 @@ int main()
 					std::getline(std::cin, text);
 					fs.remove(std::atoi(text.c_str()));
 				}
+				else if (input == "remove_recursive")
+				{
+					std::getline(std::cin, text);
+					std::cout << fs.remove_recursive(std::atoi(text.c_str())) << std::endl;
+				}
 				else if (input == "get_absolute_path")
 				{
 					std::getline(std::cin, text);
@@ -99,6 +104,35 @@ int main()
 					std::getline(std::cin, text);
 					std::cout << fs.get_file_size(text) << std::endl;
 				}
+				else if (input == "resize_file")
+				{
+					std::getline(std::cin, text);
+					const auto targetHandle = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					const auto newSize = std::atoi(text.c_str());
+					fs.resize_file(targetHandle, newSize);
+				}
+				else if (input == "move")
+				{
+					std::getline(std::cin, text);
+					const auto targetHandle = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					const auto parentHandle = std::atoi(text.c_str());
+					fs.move(targetHandle, parentHandle);
+				}
+				else if (input == "get_directory_size")
+				{
+					std::getline(std::cin, text);
+					std::cout << fs.get_directory_size(std::atoi(text.c_str())) << std::endl;
+				}
+				else if (input == "set_quota")
+				{
+					std::getline(std::cin, text);
+					const auto targetHandle = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					const auto quota = std::atoi(text.c_str());
+					fs.set_quota(targetHandle, quota);
+				}
 				else if (input == "rename")
 				{
 					std::getline(std::cin, text);
@@ -117,19 +151,144 @@ int main()
 					std::getline(std::cin, text);
 					std::cout << fs.get_handle(text) << std::endl;
 				}
+				else if (input == "resolve")
+				{
+					std::getline(std::cin, text);
+					const auto path = text;
+					std::getline(std::cin, text);
+					const auto startHandle = std::atoi(text.c_str());
+					std::cout << fs.resolve(path, startHandle) << std::endl;
+				}
+				else if (input == "reserve")
+				{
+					std::getline(std::cin, text);
+					fs.reserve(std::atoi(text.c_str()));
+				}
+				else if (input == "set_pool_policy")
+				{
+					std::getline(std::cin, text);
+					fs.set_pool_policy(static_cast<pool_policy>(std::atoi(text.c_str())));
+				}
+				else if (input == "compact")
+				{
+					const auto remap = fs.compact();
+					for (size_t oldHandle = 0; oldHandle < remap.size(); oldHandle++)
+					{
+						if (remap[oldHandle] != -1)
+						{
+							std::cout << oldHandle << "->" << remap[oldHandle] << " ";
+						}
+					}
+					std::cout << std::endl;
+				}
+				else if (input == "get_fragmentation")
+				{
+					std::cout << fs.get_fragmentation() << std::endl;
+				}
+				else if (input == "set_path_cache_capacity")
+				{
+					std::getline(std::cin, text);
+					fs.set_path_cache_capacity(std::atoi(text.c_str()));
+				}
+				else if (input == "get_path_cache_stats")
+				{
+					std::cout << fs.get_path_cache_hits() << " " << fs.get_path_cache_misses() << std::endl;
+				}
 				else if (input == "follow")
 				{
 					std::getline(std::cin, text);
 					std::cout << fs.follow(std::atoi(text.c_str())) << std::endl;
 				}
+				else if (input == "get_links_to")
+				{
+					std::getline(std::cin, text);
+					for (const auto linkHandle : fs.get_links_to(std::atoi(text.c_str())))
+					{
+						std::cout << linkHandle << " ";
+					}
+					std::cout << std::endl;
+				}
 				else if (input == "print_layout")
 				{
-					std::cout << fs.print_layout() << std::endl;
+					fs.print_layout(std::cout, layout_options{});
+					std::cout << std::endl;
+				}
+				else if (input == "print_layout_subtree")
+				{
+					layout_options options;
+					std::getline(std::cin, text);
+					options.m_root = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					options.m_maxDepth = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					options.m_skipEntries = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					options.m_maxEntries = std::atoi(text.c_str());
+					std::cout << fs.print_layout(std::cout, options) << std::endl;
+				}
+				else if (input == "save_snapshot")
+				{
+					std::getline(std::cin, text);
+					fs.save_snapshot(text);
+				}
+				else if (input == "load_snapshot")
+				{
+					std::getline(std::cin, text);
+					fs.load_snapshot(text);
+				}
+				else if (input == "open_log")
+				{
+					std::getline(std::cin, text);
+					const auto logPath = text;
+					std::getline(std::cin, text);
+					const auto snapshotPath = text;
+					std::getline(std::cin, text);
+					const auto groupSize = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					const auto checkpointInterval = std::atoi(text.c_str());
+					fs.open_log(logPath, snapshotPath, groupSize, checkpointInterval);
+				}
+				else if (input == "sync_log")
+				{
+					fs.sync_log();
+				}
+				else if (input == "checkpoint")
+				{
+					fs.checkpoint();
+				}
+				else if (input == "close_log")
+				{
+					fs.close_log();
 				}
 				else if (input == "get_largest_file_handle")
 				{
 					std::cout << fs.get_largest_file_handle() << std::endl;
 				}
+				else if (input == "get_largest_files")
+				{
+					std::getline(std::cin, text);
+					for (const auto fileHandle : fs.get_largest_files(std::atoi(text.c_str())))
+					{
+						std::cout << fileHandle << " ";
+					}
+					std::cout << std::endl;
+				}
+				else if (input == "count_files_in_range")
+				{
+					std::getline(std::cin, text);
+					const auto minSize = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					const auto maxSize = std::atoi(text.c_str());
+					std::cout << fs.count_files_in_range(minSize, maxSize) << std::endl;
+				}
+				else if (input == "get_bytes_in_range")
+				{
+					std::getline(std::cin, text);
+					const auto minSize = std::atoi(text.c_str());
+					std::getline(std::cin, text);
+					const auto maxSize = std::atoi(text.c_str());
+					std::cout << fs.get_bytes_in_range(minSize, maxSize) << std::endl;
+				}
 				else if (input == "get_available_size")
 				{
 					std::cout << fs.get_available_size() << std::endl;
@@ -0,0 +1,525 @@
+#include "filesystem.hpp"
+#include "concurrent_filesystem.hpp"
+#include "partitioned_filesystem.hpp"
+
+#include "iostream"
+#include "chrono"
+#include "cstdlib"
+#include "cstdio"
+#include "mutex"
+#include "thread"
+using namespace cs251;
+/*
+Micro benchmarks for the filesystem, built as a separate executable next to filesystem-app.
+Usage: filesystem-bench [benchmark|all] [entries]
+*/
+
+/**
+ * \brief Get the seconds elapsed since a point in time.
+ * \param start The starting point.
+ * \return The elapsed seconds.
+ */
+static double seconds_since(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * \brief Print one benchmark result line.
+ * \param benchmark The name of the benchmark.
+ * \param variant The variant being measured.
+ * \param operations The amount of operations done.
+ * \param seconds The time it took.
+ */
+static void report(const std::string& benchmark, const std::string& variant, const size_t operations, const double seconds) {
+    std::cout << benchmark << " [" << variant << "]: " << operations << " ops in " << seconds << " s ("
+        << static_cast<size_t>(operations / seconds) << " ops/s)" << std::endl;
+}
+
+/**
+ * \brief Insert many files into one directory, with and without the child name index.
+ * \param entries The amount of files to create.
+ */
+static void bench_wide_directory_insert(const size_t entries) {
+    for (bool indexed : {false, true}) {
+        filesystem fs{ static_cast<size_t>(-1), indexed };
+        const handle directory = fs.create_directory("wide");
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < entries; i++) {
+            fs.create_file(1, "file_" + std::to_string(i), directory);
+        }
+        report("wide_directory_insert", indexed ? "indexed" : "linear scan", entries, seconds_since(start));
+    }
+}
+
+/**
+ * \brief Build a manifest of directories holding files and a link each, parents before children.
+ * \param entries The approximate amount of entries.
+ * \return The manifest.
+ */
+static std::vector<manifest_entry> make_manifest(const size_t entries) {
+    std::vector<manifest_entry> manifest;
+    manifest.reserve(entries);
+    for (size_t directory = 0; manifest.size() < entries; directory++) {
+        manifest_entry entry;
+        entry.m_type = node_type::Directory;
+        entry.m_path = "/dir_" + std::to_string(directory);
+        manifest.push_back(entry);
+        for (size_t file = 0; file < 100 && manifest.size() < entries; file++) {
+            entry.m_type = node_type::File;
+            entry.m_path = "/dir_" + std::to_string(directory) + "/file_" + std::to_string(file);
+            entry.m_fileSize = (directory * 7919 + file * 104729) % 100000;
+            manifest.push_back(entry);
+        }
+        entry.m_type = node_type::Link;
+        entry.m_path = "/dir_" + std::to_string(directory) + "/first";
+        entry.m_linkTarget = "/dir_" + std::to_string(directory) + "/file_0";
+        manifest.push_back(entry);
+    }
+    return manifest;
+}
+
+/**
+ * \brief Load a manifest with load_manifest and with one create call per entry.
+ * \param entries The amount of entries.
+ */
+static void bench_bulk_load(const size_t entries) {
+    const std::vector<manifest_entry> manifest = make_manifest(entries);
+    {
+        filesystem fs{ static_cast<size_t>(-1) };
+        const auto start = std::chrono::steady_clock::now();
+        fs.load_manifest(manifest);
+        report("bulk_load", "load_manifest", manifest.size(), seconds_since(start));
+    }
+    {
+        filesystem fs{ static_cast<size_t>(-1) };
+        const auto start = std::chrono::steady_clock::now();
+        handle directory = 0;
+        for (const manifest_entry& entry : manifest) {
+            const std::string name = entry.m_path.substr(entry.m_path.rfind('/') + 1);
+            switch (entry.m_type)
+            {
+            case node_type::Directory: directory = fs.create_directory(name); break;
+            case node_type::File: fs.create_file(entry.m_fileSize, name, directory); break;
+            case node_type::Link: fs.create_link(fs.get_handle(entry.m_linkTarget), name, directory); break;
+            }
+        }
+        report("bulk_load", "create per entry", manifest.size(), seconds_since(start));
+    }
+}
+
+/**
+ * \brief Restore a filesystem from a snapshot, against replaying the manifest that built it.
+ * \param entries The amount of entries.
+ */
+static void bench_snapshot_load(const size_t entries) {
+    const std::vector<manifest_entry> manifest = make_manifest(entries);
+    const std::string path = "filesystem-bench.snapshot";
+    {
+        filesystem fs{ static_cast<size_t>(-1) };
+        const auto start = std::chrono::steady_clock::now();
+        fs.load_manifest(manifest);
+        report("snapshot_load", "replay manifest", manifest.size(), seconds_since(start));
+        fs.save_snapshot(path);
+    }
+    {
+        filesystem fs{ static_cast<size_t>(-1) };
+        const auto start = std::chrono::steady_clock::now();
+        fs.load_snapshot(path);
+        report("snapshot_load", "load_snapshot", manifest.size(), seconds_since(start));
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * \brief Create and remove files without a log, and with a log flushed per operation and per group.
+ * \param entries The amount of files to create.
+ */
+static void bench_logged_mutations(const size_t entries) {
+    const std::string logPath = "filesystem-bench.log";
+    const std::string snapshotPath = "filesystem-bench.snapshot";
+    for (size_t groupSize : {0, 1, 64, 1024}) {
+        std::remove(logPath.c_str());
+        std::remove(snapshotPath.c_str());
+        filesystem fs{ static_cast<size_t>(-1) };
+        if (groupSize != 0) {
+            fs.open_log(logPath, snapshotPath, groupSize);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < entries; i++) {
+            const handle file = fs.create_file(i, "file_" + std::to_string(i), 0);
+            if (i % 4 == 0) {
+                fs.remove(file);
+            }
+        }
+        if (groupSize != 0) {
+            fs.sync_log();
+        }
+        const size_t operations = entries + (entries + 3) / 4;
+        report("logged_mutations", groupSize == 0 ? "unlogged" : "group of " + std::to_string(groupSize), operations, seconds_since(start));
+    }
+    {
+        filesystem fs{ static_cast<size_t>(-1) };
+        const auto start = std::chrono::steady_clock::now();
+        fs.open_log(logPath, snapshotPath);
+        report("logged_mutations", "recover from log", entries + (entries + 3) / 4, seconds_since(start));
+    }
+    std::remove(logPath.c_str());
+    std::remove(snapshotPath.c_str());
+}
+
+/**
+ * \brief Resolve paths in a deep chain of directories and in one wide directory.
+ * \param entries The amount of files in the wide directory, and of lookups per variant.
+ */
+static void bench_path_lookup(const size_t entries) {
+    filesystem fs{ static_cast<size_t>(-1) };
+    std::string deepPath;
+    handle directory = 0;
+    for (int depth = 0; depth < 32; depth++) {
+        const std::string name = "directory_" + std::to_string(depth);
+        directory = fs.create_directory(name, directory);
+        deepPath += "/" + name;
+    }
+    const handle deepDirectory = directory;
+    fs.create_file(1, "leaf.txt", deepDirectory);
+    deepPath += "/leaf.txt";
+    const handle wide = fs.create_directory("wide");
+    std::vector<std::string> widePaths;
+    for (size_t i = 0; i < entries; i++) {
+        fs.create_file(1, "file_" + std::to_string(i), wide);
+        widePaths.push_back("/wide/file_" + std::to_string((i * 7919) % entries));
+    }
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; i++) {
+        checksum += fs.get_handle(deepPath);
+    }
+    report("path_lookup", "deep absolute", entries, seconds_since(start));
+    start = std::chrono::steady_clock::now();
+    for (const std::string& path : widePaths) {
+        checksum += fs.get_handle(path);
+    }
+    report("path_lookup", "wide absolute", entries, seconds_since(start));
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; i++) {
+        checksum += fs.resolve("../directory_31/./leaf.txt", deepDirectory);
+    }
+    report("path_lookup", "relative with dot components", entries, seconds_since(start));
+    if (checksum == 0) {
+        std::cout << "unexpected checksum" << std::endl;
+    }
+}
+
+/**
+ * \brief Resolve a small set of hot deep paths with and without the path cache, with a rename every 1000 lookups in the churn variant.
+ * \param entries The amount of lookups per variant.
+ */
+static void bench_hot_path_lookup(const size_t entries) {
+    for (int variant = 0; variant < 3; variant++) {
+        filesystem fs{ static_cast<size_t>(-1) };
+        fs.set_path_cache_capacity(variant == 0 ? 0 : 4096);
+        std::vector<std::string> hotPaths;
+        for (int tree = 0; tree < 64; tree++) {
+            std::string path = "/tree_" + std::to_string(tree);
+            handle directory = fs.create_directory("tree_" + std::to_string(tree));
+            for (int depth = 1; depth < 16; depth++) {
+                const std::string name = "directory_" + std::to_string(depth);
+                directory = fs.create_directory(name, directory);
+                path += "/" + name;
+            }
+            fs.create_file(1, "hot.txt", directory);
+            hotPaths.push_back(path + "/hot.txt");
+        }
+        const handle churn = fs.create_directory("churn");
+        size_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < entries; i++) {
+            if ((variant == 2) && (i % 1000 == 0)) {
+                fs.rename(churn, "churn_" + std::to_string(i));
+            }
+            checksum += fs.get_handle(hotPaths[i % hotPaths.size()]);
+        }
+        const double seconds = seconds_since(start);
+        report("hot_path_lookup", variant == 0 ? "uncached" : variant == 1 ? "cached" : "cached with renames", entries, seconds);
+        if (variant != 0) {
+            std::cout << "  " << fs.get_path_cache_hits() << " hits, " << fs.get_path_cache_misses() << " misses" << std::endl;
+        }
+        if (checksum == 0) {
+            std::cout << "unexpected checksum" << std::endl;
+        }
+    }
+}
+
+/**
+ * \brief Build the absolute path of every file in deep directories, with and without the memoized parent path.
+ * \param entries The amount of files.
+ */
+static void bench_absolute_path(const size_t entries) {
+    for (bool memoized : {false, true}) {
+        filesystem fs{ static_cast<size_t>(-1) };
+        fs.set_parent_path_cache_enabled(memoized);
+        std::vector<handle> files;
+        for (size_t tree = 0; files.size() < entries; tree++) {
+            handle directory = fs.create_directory("tree_" + std::to_string(tree));
+            for (int depth = 1; depth < 32; depth++) {
+                directory = fs.create_directory("directory_" + std::to_string(depth), directory);
+            }
+            for (size_t file = 0; file < 100 && files.size() < entries; file++) {
+                files.push_back(fs.create_file(1, "file_" + std::to_string(file), directory));
+            }
+        }
+        size_t bytes = 0;
+        std::string path;
+        auto start = std::chrono::steady_clock::now();
+        for (handle file : files) {
+            fs.get_absolute_path(file, path);
+            bytes += path.size();
+        }
+        report("absolute_path", memoized ? "memoized parent, reused buffer" : "reused buffer", files.size(), seconds_since(start));
+        start = std::chrono::steady_clock::now();
+        for (handle file : files) {
+            bytes += fs.get_absolute_path(file).size();
+        }
+        report("absolute_path", memoized ? "memoized parent, new string" : "new string", files.size(), seconds_since(start));
+        if (bytes == 0) {
+            std::cout << "unexpected path length" << std::endl;
+        }
+    }
+}
+
+/**
+ * \brief Resolve paths through a chain of links to a directory, with the path cache off so every lookup follows the links.
+ * \param entries The amount of lookups.
+ */
+static void bench_link_follow(const size_t entries) {
+    filesystem fs{ static_cast<size_t>(-1) };
+    fs.set_path_cache_capacity(0);
+    const handle directory = fs.create_directory("target");
+    fs.create_file(1, "file", directory);
+    handle link = directory;
+    for (int i = 0; i < 8; i++) {
+        link = fs.create_link(link, "link_" + std::to_string(i));
+    }
+    size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; i++) {
+        checksum += fs.get_handle("/link_7/file");
+    }
+    report("link_follow", "chain of 8 links", entries, seconds_since(start));
+    if (checksum == 0) {
+        std::cout << "unexpected checksum" << std::endl;
+    }
+}
+
+/**
+ * \brief Print the layout of deep directories, into one string and streamed in pages to a discarding stream.
+ * \param entries The amount of files.
+ */
+static void bench_print_layout(const size_t entries) {
+    filesystem fs{ static_cast<size_t>(-1) };
+    size_t created = 0;
+    for (size_t tree = 0; created < entries; tree++) {
+        handle directory = fs.create_directory("tree_" + std::to_string(tree));
+        for (int depth = 1; depth < 32; depth++) {
+            directory = fs.create_directory("directory_" + std::to_string(depth), directory);
+        }
+        for (size_t file = 0; file < 100 && created < entries; file++, created++) {
+            fs.create_file(1, "file_" + std::to_string(file), directory);
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    const size_t bytes = fs.print_layout().size();
+    report("print_layout", "whole string", created, seconds_since(start));
+    std::ostream discard{ nullptr };
+    layout_options options;
+    options.m_maxEntries = 4096;
+    size_t written = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t page = 0; (page = fs.print_layout(discard, options)) != 0; options.m_skipEntries += page) {
+        written += page;
+    }
+    report("print_layout", "streamed in pages of 4096", created, seconds_since(start));
+    start = std::chrono::steady_clock::now();
+    written += fs.print_layout(discard, layout_options{});
+    report("print_layout", "streamed at once", created, seconds_since(start));
+    // Files created round robin across directories leave every listing scattered over the node arrays.
+    filesystem interleaved{ static_cast<size_t>(-1) };
+    std::vector<handle> directories;
+    for (size_t directory = 0; directory < created / 100; directory++) {
+        directories.push_back(interleaved.create_directory("directory_" + std::to_string(directory)));
+    }
+    for (size_t file = 0; file < created; file++) {
+        interleaved.create_file(1, "file_" + std::to_string(file), directories[file % directories.size()]);
+    }
+    start = std::chrono::steady_clock::now();
+    written += interleaved.print_layout(discard, layout_options{});
+    report("print_layout", "interleaved, streamed at once", created, seconds_since(start));
+    interleaved.compact();
+    start = std::chrono::steady_clock::now();
+    written += interleaved.print_layout(discard, layout_options{});
+    report("print_layout", "interleaved, streamed at once after compact", created, seconds_since(start));
+    if ((bytes == 0) || (written < 2 * created)) {
+        std::cout << "unexpected layout" << std::endl;
+    }
+}
+
+/**
+ * \brief Run the same mix of operations on a growing amount of threads, each doing its share of the operations.
+ * \param benchmark The name of the benchmark.
+ * \param variant The variant being measured.
+ * \param entries The amount of operations per thread count.
+ * \param operation Called with the thread and the operation index.
+ */
+template <typename function>
+static void run_threads(const std::string& benchmark, const std::string& variant, const size_t entries, function operation) {
+    for (size_t threadCount = 1; threadCount <= 64; threadCount *= 2) {
+        std::vector<std::thread> threads;
+        const size_t share = entries / threadCount;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t thread = 0; thread < threadCount; thread++) {
+            threads.emplace_back([&operation, thread, share]() {
+                for (size_t i = 0; i < share; i++) {
+                    operation(thread, i);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        report(benchmark, variant + ", " + std::to_string(threadCount) + " threads", share * threadCount, seconds_since(start));
+    }
+}
+
+/**
+ * \brief Look up file sizes by path from many threads while one operation in 32 resizes a file,
+ * with one mutex around a filesystem and with the reader-writer concurrent filesystem.
+ * \param entries The amount of operations per thread count.
+ */
+static void bench_concurrent_mix(const size_t entries) {
+    const size_t directoryCount = 64;
+    const size_t fileCount = 64;
+    std::vector<std::string> paths;
+    std::vector<handle> files;
+    filesystem locked{ static_cast<size_t>(-1) };
+    concurrent_filesystem shared{ static_cast<size_t>(-1) };
+    for (size_t directory = 0; directory < directoryCount; directory++) {
+        const std::string directoryName = "directory_" + std::to_string(directory);
+        const handle lockedDirectory = locked.create_directory(directoryName);
+        const handle sharedDirectory = shared.create_directory(directoryName);
+        for (size_t file = 0; file < fileCount; file++) {
+            const std::string fileName = "file_" + std::to_string(file);
+            files.push_back(locked.create_file(1, fileName, lockedDirectory));
+            shared.create_file(1, fileName, sharedDirectory);
+            paths.push_back("/" + directoryName + "/" + fileName);
+        }
+    }
+    std::mutex mutex;
+    run_threads("concurrent_mix", "one mutex", entries, [&](const size_t thread, const size_t i) {
+        const size_t index = (thread * 7919 + i * 104729) % files.size();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (i % 32 == 0) {
+            locked.resize_file(files[index], i % 1024);
+        } else {
+            locked.get_file_size(paths[index]);
+        }
+    });
+    run_threads("concurrent_mix", "reader-writer", entries, [&](const size_t thread, const size_t i) {
+        const size_t index = (thread * 7919 + i * 104729) % files.size();
+        if (i % 32 == 0) {
+            shared.resize_file(files[index], i % 1024);
+        } else {
+            shared.get_file_size(paths[index]);
+        }
+    });
+}
+
+/**
+ * \brief Create and remove files from many threads, every thread in a top-level directory of its own,
+ * with the reader-writer filesystem serializing all of them and with the partitioned filesystem. The last variant
+ * gives every thread a sibling subdirectory of one top-level directory instead, which puts all of them in one
+ * partition of the partitioned filesystem.
+ * \param entries The amount of operations per thread count.
+ */
+static void bench_partitioned_create(const size_t entries) {
+    const auto mix = [entries](const std::string& variant, auto& fs, const bool siblings) {
+        std::vector<handle> directories;
+        const handle parent = siblings ? fs.create_directory("tenants") : 0;
+        for (size_t thread = 0; thread < 64; thread++) {
+            directories.push_back(fs.create_directory("tenant_" + std::to_string(thread), parent));
+        }
+        std::vector<std::string> names;
+        for (size_t i = 0; i < 64; i++) {
+            names.push_back("file_" + std::to_string(i));
+        }
+        run_threads("partitioned_create", variant, entries, [&](const size_t thread, const size_t i) {
+            // Every other operation removes the file the one before created, so directories stay small.
+            thread_local handle lastHandle = -1;
+            if (i % 2 == 0) {
+                lastHandle = fs.create_file(1, names[(i / 2) % names.size()], directories[thread]);
+            } else {
+                fs.remove(lastHandle);
+            }
+        });
+    };
+    concurrent_filesystem shared{ static_cast<size_t>(-1) };
+    mix("reader-writer", shared, false);
+    partitioned_filesystem partitioned{ static_cast<size_t>(-1), 64 };
+    mix("64 partitions", partitioned, false);
+    partitioned_filesystem siblings{ static_cast<size_t>(-1), 64 };
+    mix("64 partitions, sibling subdirectories", siblings, true);
+}
+
+int main(int argc, char** argv) {
+    const std::string benchmark = argc > 1 ? argv[1] : "all";
+    const size_t entries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+    bool ran = false;
+    if (benchmark == "all" || benchmark == "wide_directory_insert") {
+        bench_wide_directory_insert(entries);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "bulk_load") {
+        bench_bulk_load(entries * 50);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "snapshot_load") {
+        bench_snapshot_load(entries * 50);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "logged_mutations") {
+        bench_logged_mutations(entries);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "path_lookup") {
+        bench_path_lookup(entries * 10);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "hot_path_lookup") {
+        bench_hot_path_lookup(entries * 50);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "absolute_path") {
+        bench_absolute_path(entries * 10);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "link_follow") {
+        bench_link_follow(entries * 50);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "print_layout") {
+        bench_print_layout(entries * 10);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "concurrent_mix") {
+        bench_concurrent_mix(entries * 50);
+        ran = true;
+    }
+    if (benchmark == "all" || benchmark == "partitioned_create") {
+        bench_partitioned_create(entries * 10);
+        ran = true;
+    }
+    if (!ran) {
+        std::cerr << "Unknown benchmark: " << benchmark << std::endl;
+        return 1;
+    }
+    return 0;
+}
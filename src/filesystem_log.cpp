@@ -0,0 +1,107 @@
+#include "filesystem.hpp"
+
+#include "cerrno"
+#include "sys/stat.h"
+
+using namespace cs251;
+
+void filesystem::open_log(const std::string& logPath, const std::string& snapshotPath, const size_t groupSize, const size_t checkpointInterval) {
+    if (m_log) {
+        close_log();
+    }
+    if (m_fileSystemNodes.ref_node(0).get_child_count() != 0) {
+        throw filesystem_not_empty();
+    }
+    struct stat status {};
+    if (stat(snapshotPath.c_str(), &status) == 0) {
+        load_snapshot(snapshotPath);
+    } else if (errno != ENOENT) {
+        throw snapshot_io_error();
+    }
+    std::unique_ptr<operation_log> log = std::make_unique<operation_log>(logPath, groupSize);
+    // Records up to the snapshot's sequence number are already in it, when a crash came between saving it and truncating the log.
+    for (const operation_record& record : log->read_records()) {
+        if (record.m_sequence <= m_logSequence) {
+            continue;
+        }
+        if (record.m_sequence != m_logSequence + 1) {
+            throw invalid_log();
+        }
+        try {
+            replay_operation(record);
+        } catch (const std::runtime_error&) {
+            throw invalid_log();
+        }
+        m_logSequence = record.m_sequence;
+    }
+    m_log = std::move(log);
+    m_snapshotPath = snapshotPath;
+    m_checkpointInterval = checkpointInterval;
+    m_operationsSinceCheckpoint = 0;
+}
+
+void filesystem::sync_log() {
+    if (!m_log) {
+        throw log_not_open();
+    }
+    m_log->commit();
+}
+
+void filesystem::checkpoint() {
+    if (!m_log) {
+        throw log_not_open();
+    }
+    // save_snapshot returns only once the renamed snapshot and its directory entry are synced,
+    // so the log is never emptied while a crash could still bring back the previous snapshot.
+    save_snapshot(m_snapshotPath);
+    m_log->truncate();
+    m_operationsSinceCheckpoint = 0;
+}
+
+void filesystem::close_log() {
+    if (!m_log) {
+        throw log_not_open();
+    }
+    m_log->commit();
+    m_log.reset();
+}
+
+void filesystem::log_operation(const operation_type type, const handle targetHandle, const handle otherHandle, const size_t value, const std::string& name) {
+    if (!m_log) {
+        return;
+    }
+    operation_record record;
+    record.m_sequence = ++m_logSequence;
+    record.m_type = type;
+    record.m_handle = targetHandle;
+    record.m_target = otherHandle;
+    record.m_value = value;
+    record.m_name = name;
+    m_log->append(record);
+    m_operationsSinceCheckpoint += 1;
+    if ((m_checkpointInterval != 0) && (m_operationsSinceCheckpoint >= m_checkpointInterval)) {
+        checkpoint();
+    }
+}
+
+void filesystem::replay_operation(const operation_record& record) {
+    switch (record.m_type)
+    {
+    case operation_type::CreateFile: create_file(record.m_value, record.m_name, record.m_handle); break;
+    case operation_type::CreateDirectory: create_directory(record.m_name, record.m_handle); break;
+    case operation_type::CreateLink: create_link(record.m_target, record.m_name, record.m_handle); break;
+    case operation_type::Remove: remove(record.m_handle); break;
+    case operation_type::RemoveRecursive: remove_recursive(record.m_handle); break;
+    case operation_type::Rename: rename(record.m_handle, record.m_name); break;
+    case operation_type::Move: move(record.m_handle, record.m_target); break;
+    case operation_type::ResizeFile: resize_file(record.m_handle, record.m_value); break;
+    case operation_type::SetQuota: set_quota(record.m_handle, record.m_value); break;
+    case operation_type::SetPoolPolicy:
+        if (record.m_value > static_cast<size_t>(pool_policy::NearParent)) {
+            throw invalid_log();
+        }
+        set_pool_policy(static_cast<pool_policy>(record.m_value));
+        break;
+    default: throw invalid_log();
+    }
+}
@@ -0,0 +1,389 @@
+#include "filesystem.hpp"
+
+#include "algorithm"
+#include "cstdint"
+#include "cstdio"
+#include "cstring"
+#include "unordered_set"
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "unistd.h"
+
+using namespace cs251;
+
+/*
+Snapshot layout, all fields in host byte order:
+  snapshot_header                        including the pool policy and the sequence number of the last logged operation it holds
+  uint32_t generations[slotCount]        generation of every slot, live or recycled
+  snapshot_node nodes[nodeCount]         live nodes in preorder, so parents come before children
+  int32_t pool[poolCount]                recycled handles in reuse order
+  snapshot_heap_node heap[heapCount]     the max heap array, already in heap order
+  char names[nameBytes]                  all names back to back, referenced by offset and length
+*/
+namespace {
+    const char snapshot_magic[8] = { 'C', 'S', '2', '5', '1', 'F', 'S', '\0' };
+    const uint32_t snapshot_version = 2;
+
+    struct snapshot_header {
+        char m_magic[8];
+        uint32_t m_version;
+        uint32_t m_poolPolicy;
+        uint64_t m_sizeLimit;
+        uint64_t m_currentSize;
+        uint64_t m_slotCount;
+        uint64_t m_nodeCount;
+        uint64_t m_poolCount;
+        uint64_t m_heapCount;
+        uint64_t m_nameBytes;
+        uint64_t m_logSequence;
+    };
+
+    struct snapshot_node {
+        int32_t m_handle;
+        int32_t m_parentHandle;
+        int32_t m_linkedHandle;
+        uint32_t m_type;
+        uint64_t m_fileSize;
+        uint64_t m_quota;
+        uint64_t m_usage[4];
+        uint64_t m_nameOffset;
+        uint64_t m_nameLength;
+    };
+
+    struct snapshot_heap_node {
+        int32_t m_handle;
+        uint32_t m_reserved;
+        uint64_t m_value;
+    };
+
+    /**
+     * \brief Append the raw bytes of a value to a buffer.
+     * \param buffer The buffer.
+     * \param value The value to append.
+     */
+    template<typename T>
+    void append(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * Read-only mapping of a whole file, unmapped when it goes out of scope.
+     */
+    class mapped_file {
+    public:
+        explicit mapped_file(const std::string& path) {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if (fd == -1) {
+                throw snapshot_io_error();
+            }
+            struct stat status {};
+            if (fstat(fd, &status) == -1) {
+                close(fd);
+                throw snapshot_io_error();
+            }
+            m_size = static_cast<size_t>(status.st_size);
+            if (m_size > 0) {
+                void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    close(fd);
+                    throw snapshot_io_error();
+                }
+                m_data = static_cast<const char*>(data);
+            }
+            close(fd);
+        }
+        ~mapped_file() {
+            if (m_data != nullptr) {
+                munmap(const_cast<char*>(m_data), m_size);
+            }
+        }
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        /**
+         * \brief Get a pointer to a range of the file, checking that it is inside the file.
+         * \param offset The start of the range.
+         * \param bytes The length of the range.
+         * \return The pointer to the start of the range.
+         */
+        const char* at(const uint64_t offset, const uint64_t bytes) const {
+            if ((offset > m_size) || (bytes > m_size - offset)) {
+                throw invalid_snapshot();
+            }
+            return m_data + offset;
+        }
+    private:
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+    };
+
+    /**
+     * \brief Multiply two record counts, rejecting overflow from a corrupt header.
+     */
+    uint64_t checked_bytes(const uint64_t count, const uint64_t recordSize) {
+        if (count > UINT64_MAX / recordSize) {
+            throw invalid_snapshot();
+        }
+        return count * recordSize;
+    }
+}
+
+void filesystem::save_snapshot(const std::string& path) const {
+    const chunked_vector<tree_node<filesystem_node_data>>& nodes = m_fileSystemNodes.peek_nodes();
+    const std::vector<handle> pool = m_fileSystemNodes.peek_pool();
+    const std::vector<file_size_max_heap_node>& heap = m_maxHeap.peek_nodes();
+
+    std::string generations;
+    for (const tree_node<filesystem_node_data>& node : nodes) {
+        append<uint32_t>(generations, node.get_generation());
+    }
+
+    // Preorder over the sibling links, so restoring in this order appends every child after its parent and older siblings.
+    std::string records;
+    std::string names;
+    // Interned names are written once and shared by every record that uses them.
+    std::vector<uint64_t> nameOffsets(m_names->size(), UINT64_MAX);
+    uint64_t nodeCount = 0;
+    handle h = 0;
+    while (h != -1) {
+        const tree_node<filesystem_node_data>& node = nodes[h];
+        const filesystem_node_data& data = node.peek_data();
+        snapshot_node record{};
+        record.m_handle = h;
+        record.m_parentHandle = node.get_parent_handle();
+        record.m_linkedHandle = data.m_linkedHandle;
+        record.m_type = static_cast<uint32_t>(data.m_type);
+        record.m_fileSize = data.m_fileSize;
+        record.m_quota = data.m_quota;
+        record.m_usage[0] = data.m_usage.m_bytes;
+        record.m_usage[1] = data.m_usage.m_fileCount;
+        record.m_usage[2] = data.m_usage.m_directoryCount;
+        record.m_usage[3] = data.m_usage.m_linkCount;
+        const std::string_view name = m_names->view(data.m_name);
+        if (nameOffsets[data.m_name] == UINT64_MAX) {
+            nameOffsets[data.m_name] = names.size();
+            names += name;
+        }
+        record.m_nameOffset = nameOffsets[data.m_name];
+        record.m_nameLength = name.size();
+        append(records, record);
+        nodeCount += 1;
+        if (node.get_first_child_handle() != -1) {
+            h = node.get_first_child_handle();
+        } else {
+            while ((h != -1) && (nodes[h].get_next_sibling_handle() == -1)) {
+                h = nodes[h].get_parent_handle();
+            }
+            if (h != -1) {
+                h = nodes[h].get_next_sibling_handle();
+            }
+        }
+    }
+
+    std::string buffer;
+    snapshot_header header{};
+    std::copy(snapshot_magic, snapshot_magic + sizeof(snapshot_magic), header.m_magic);
+    header.m_version = snapshot_version;
+    header.m_poolPolicy = static_cast<uint32_t>(m_fileSystemNodes.get_pool_policy());
+    header.m_sizeLimit = m_sizeLimit;
+    header.m_currentSize = m_currentSize;
+    header.m_slotCount = nodes.size();
+    header.m_nodeCount = nodeCount;
+    header.m_poolCount = pool.size();
+    header.m_heapCount = heap.size();
+    header.m_nameBytes = names.size();
+    header.m_logSequence = m_logSequence;
+    append(buffer, header);
+    buffer += generations;
+    buffer += records;
+    for (handle pooled : pool) {
+        append<int32_t>(buffer, pooled);
+    }
+    for (const file_size_max_heap_node& file : heap) {
+        snapshot_heap_node record{};
+        record.m_handle = file.m_handle;
+        record.m_value = file.m_value;
+        append(buffer, record);
+    }
+    buffer += names;
+
+    const std::string temporaryPath = path + ".tmp";
+    const int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw snapshot_io_error();
+    }
+    size_t written = 0;
+    while (written < buffer.size()) {
+        const ssize_t result = write(fd, buffer.data() + written, buffer.size() - written);
+        if (result <= 0) {
+            close(fd);
+            throw snapshot_io_error();
+        }
+        written += static_cast<size_t>(result);
+    }
+    if ((fsync(fd) == -1) | (close(fd) == -1)) {
+        throw snapshot_io_error();
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        throw snapshot_io_error();
+    }
+    // The rename is only durable once the directory holding it is synced.
+    const size_t separator = path.find_last_of('/');
+    const std::string directoryPath = separator == std::string::npos ? "." : (separator == 0 ? "/" : path.substr(0, separator));
+    const int directoryFd = open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directoryFd == -1) {
+        throw snapshot_io_error();
+    }
+    if ((fsync(directoryFd) == -1) | (close(directoryFd) == -1)) {
+        throw snapshot_io_error();
+    }
+}
+
+void filesystem::load_snapshot(const std::string& path) {
+    const mapped_file file(path);
+    snapshot_header header;
+    std::memcpy(&header, file.at(0, sizeof(header)), sizeof(header));
+    if ((std::memcmp(header.m_magic, snapshot_magic, sizeof(snapshot_magic)) != 0) || (header.m_version != snapshot_version)) {
+        throw invalid_snapshot();
+    }
+    if ((header.m_slotCount == 0) || (header.m_slotCount > static_cast<uint64_t>(INT32_MAX)) || (header.m_nodeCount > header.m_slotCount)
+        || (header.m_poolPolicy > static_cast<uint32_t>(pool_policy::NearParent))) {
+        throw invalid_snapshot();
+    }
+    uint64_t offset = sizeof(header);
+    const char* generationData = file.at(offset, checked_bytes(header.m_slotCount, sizeof(uint32_t)));
+    offset += header.m_slotCount * sizeof(uint32_t);
+    const char* nodeData = file.at(offset, checked_bytes(header.m_nodeCount, sizeof(snapshot_node)));
+    offset += header.m_nodeCount * sizeof(snapshot_node);
+    const char* poolData = file.at(offset, checked_bytes(header.m_poolCount, sizeof(int32_t)));
+    offset += header.m_poolCount * sizeof(int32_t);
+    const char* heapData = file.at(offset, checked_bytes(header.m_heapCount, sizeof(snapshot_heap_node)));
+    offset += header.m_heapCount * sizeof(snapshot_heap_node);
+    const char* nameData = file.at(offset, header.m_nameBytes);
+
+    // Rebuild into a fresh tree so a corrupt snapshot leaves the current contents untouched.
+    std::unique_ptr<name_pool> namePool = std::make_unique<name_pool>();
+    const name_pool* names = namePool.get();
+    tree<filesystem_node_data> nodes;
+    nodes.set_child_key([names](const filesystem_node_data& data) {
+        return names->view(data.m_name);
+    });
+    nodes.set_child_index_enabled(m_fileSystemNodes.is_child_index_enabled());
+    // The pool is stored in reuse order, which only means the same thing under the policy it was saved with.
+    nodes.set_pool_policy(static_cast<pool_policy>(header.m_poolPolicy));
+    std::vector<unsigned int> generations(header.m_slotCount);
+    for (size_t i = 0; i < generations.size(); i++) {
+        uint32_t generation;
+        std::memcpy(&generation, generationData + i * sizeof(uint32_t), sizeof(uint32_t));
+        generations[i] = generation;
+    }
+    size_t quotaCount = 0;
+    file_size_index sizeIndex;
+    std::vector<std::pair<size_t, handle>> sizes;
+    std::unordered_map<handle, std::vector<handle>> linksTo;
+    // Every parent and name pair, packed into one key, so duplicate siblings are found whether or not the child index is on.
+    std::unordered_set<uint64_t> siblingNames;
+    try {
+        nodes.restore_reset(generations);
+        for (uint64_t i = 0; i < header.m_nodeCount; i++) {
+            snapshot_node record;
+            std::memcpy(&record, nodeData + i * sizeof(snapshot_node), sizeof(snapshot_node));
+            if ((record.m_type > static_cast<uint32_t>(node_type::Link)) || (record.m_linkedHandle < -1)
+                || (static_cast<int64_t>(record.m_linkedHandle) >= static_cast<int64_t>(header.m_slotCount))
+                || ((record.m_type != static_cast<uint32_t>(node_type::Link)) && (record.m_linkedHandle != -1)) || (record.m_nameOffset > header.m_nameBytes)
+                || (record.m_nameLength > header.m_nameBytes - record.m_nameOffset)) {
+                throw invalid_snapshot();
+            }
+            const std::string_view name(nameData + record.m_nameOffset, record.m_nameLength);
+            // Only the root has no name; every other name must be one the create paths would have accepted.
+            if (record.m_parentHandle == -1) {
+                if (!name.empty()) {
+                    throw invalid_snapshot();
+                }
+            } else {
+                check_name(name);
+            }
+            filesystem_node_data data;
+            data.m_type = static_cast<node_type>(record.m_type);
+            data.m_linkedHandle = record.m_linkedHandle;
+            data.m_name = namePool->intern(name);
+            if (!siblingNames.insert((static_cast<uint64_t>(static_cast<uint32_t>(record.m_parentHandle)) << 32) | data.m_name).second) {
+                throw invalid_snapshot();
+            }
+            data.m_fileSize = record.m_fileSize;
+            data.m_quota = record.m_quota;
+            data.m_usage.m_bytes = record.m_usage[0];
+            data.m_usage.m_fileCount = record.m_usage[1];
+            data.m_usage.m_directoryCount = record.m_usage[2];
+            data.m_usage.m_linkCount = record.m_usage[3];
+            nodes.restore_node(record.m_handle, record.m_parentHandle, data);
+            if (data.m_quota != static_cast<size_t>(-1)) {
+                quotaCount += 1;
+            }
+            if (data.m_type == node_type::File) {
+                sizes.emplace_back(data.m_fileSize, record.m_handle);
+            } else if ((data.m_type == node_type::Link) && (data.m_linkedHandle != -1)) {
+                linksTo[data.m_linkedHandle].push_back(record.m_handle);
+            }
+        }
+        std::vector<handle> pool(header.m_poolCount);
+        for (size_t i = 0; i < pool.size(); i++) {
+            int32_t pooled;
+            std::memcpy(&pooled, poolData + i * sizeof(int32_t), sizeof(int32_t));
+            pool[i] = pooled;
+        }
+        nodes.restore_pool(pool);
+        // Removing a target detaches its links, so a link can only point at a live node.
+        for (const auto& target : linksTo) {
+            if (!nodes.is_alive(target.first)) {
+                throw invalid_snapshot();
+            }
+        }
+    } catch (const invalid_handle&) {
+        throw invalid_snapshot();
+    } catch (const recycled_node&) {
+        throw invalid_snapshot();
+    } catch (const invalid_name&) {
+        throw invalid_snapshot();
+    }
+    std::vector<file_size_max_heap_node> heap(header.m_heapCount);
+    std::vector<bool> inHeap(header.m_slotCount, false);
+    for (size_t i = 0; i < heap.size(); i++) {
+        snapshot_heap_node record;
+        std::memcpy(&record, heapData + i * sizeof(snapshot_heap_node), sizeof(snapshot_heap_node));
+        if (!nodes.is_alive(record.m_handle) || (nodes.ref_node(record.m_handle).ref_data().m_type != node_type::File)
+            || (nodes.ref_node(record.m_handle).ref_data().m_fileSize != record.m_value) || inHeap[record.m_handle]) {
+            throw invalid_snapshot();
+        }
+        inHeap[record.m_handle] = true;
+        heap[i].m_handle = record.m_handle;
+        heap[i].m_value = record.m_value;
+    }
+    if (heap.size() != sizes.size()) {
+        throw invalid_snapshot();
+    }
+    file_size_max_heap maxHeap;
+    try {
+        maxHeap.push_all(heap);
+        sizeIndex.insert_all(std::move(sizes));
+    } catch (const invalid_handle&) {
+        throw invalid_snapshot();
+    }
+
+    m_fileSystemNodes = std::move(nodes);
+    m_names = std::move(namePool);
+    m_maxHeap = std::move(maxHeap);
+    m_sizeIndex = std::move(sizeIndex);
+    m_sizeLimit = header.m_sizeLimit;
+    m_currentSize = header.m_currentSize;
+    m_quotaCount = quotaCount;
+    m_linksTo = std::move(linksTo);
+    m_logSequence = header.m_logSequence;
+    // Restored generations can match entries cached before the load.
+    invalidate_paths();
+    invalidate_links();
+    if (m_log) {
+        checkpoint();
+    }
+}
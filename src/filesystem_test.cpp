@@ -0,0 +1,162 @@
+#include "filesystem.hpp"
+
+#include "iostream"
+#include "cstdio"
+#include "functional"
+using namespace cs251;
+/*
+Regression tests for the filesystem, built as a separate executable next to filesystem-app.
+Usage: filesystem-test [test|all]
+The exit status is the amount of failed tests.
+*/
+
+/**
+ * \brief Print a failed check.
+ * \param condition The checked condition.
+ * \param message What was expected.
+ * \return The condition.
+ */
+static bool check(const bool condition, const std::string& message) {
+    if (!condition) {
+        std::cout << "  failed: " << message << std::endl;
+    }
+    return condition;
+}
+
+/**
+ * \brief Run an action and tell if it threw a given exception.
+ * \param action The action.
+ * \return If the action threw exception_type.
+ */
+template <typename exception_type>
+static bool throws(const std::function<void()>& action) {
+    try {
+        action();
+    } catch (const exception_type&) {
+        return true;
+    } catch (...) {
+        return false;
+    }
+    return false;
+}
+
+/**
+ * \brief A manifest that fails under an open log rolls back through the pool. Recovery must hand out the same
+ * handles afterwards, so the operations logged after it still apply to the same files.
+ * \return If the test passed.
+ */
+static bool test_manifest_failure_recovery() {
+    const std::string logPath = "filesystem-test.log";
+    const std::string snapshotPath = "filesystem-test.snapshot";
+    bool passed = true;
+    for (const pool_policy policy : { pool_policy::Fifo, pool_policy::Lifo, pool_policy::NearParent }) {
+        std::remove(logPath.c_str());
+        std::remove(snapshotPath.c_str());
+        {
+            filesystem fs{ 1000 };
+            fs.open_log(logPath, snapshotPath, 1);
+            fs.set_pool_policy(policy);
+            std::vector<handle> removed;
+            for (int i = 0; i < 6; i++) {
+                removed.push_back(fs.create_file(1, "removed_" + std::to_string(i)));
+            }
+            for (const handle h : removed) {
+                fs.remove(h);
+            }
+            std::vector<manifest_entry> entries(4);
+            entries[0].m_path = "/directory";
+            entries[0].m_type = node_type::Directory;
+            entries[1].m_path = "/directory/a";
+            entries[2].m_path = "/directory/b";
+            entries[3].m_path = "/directory/too_large";
+            entries[3].m_fileSize = 5000;
+            passed &= check(throws<exceeds_size>([&]() { fs.load_manifest(entries); }), "the manifest exceeds the size limit");
+            const handle x = fs.create_file(1, "x");
+            fs.create_file(2, "y");
+            fs.rename(x, "renamed");
+            fs.close_log();
+        }
+        filesystem recovered{ 1000 };
+        recovered.open_log(logPath, snapshotPath, 1);
+        passed &= check(recovered.get_file_size("/renamed") == 1, "the renamed file keeps its size after recovery");
+        passed &= check(recovered.get_file_size("/y") == 2, "the other file keeps its size after recovery");
+        recovered.close_log();
+    }
+    std::remove(logPath.c_str());
+    std::remove(snapshotPath.c_str());
+    return passed;
+}
+
+/**
+ * \brief get_file_size follows links with the same hop limit as follow, so neither a self link nor an overlong
+ * chain can recurse without bound.
+ * \return If the test passed.
+ */
+static bool test_file_size_link_cycle() {
+    bool passed = true;
+    filesystem fs{ 1000 };
+    std::vector<manifest_entry> entries(1);
+    entries[0].m_path = "/self";
+    entries[0].m_type = node_type::Link;
+    entries[0].m_linkTarget = "/self";
+    passed &= check(throws<link_cycle>([&]() { fs.load_manifest(entries); }), "a manifest link to itself is a cycle");
+    std::vector<handle> chain{ fs.create_file(7, "file") };
+    for (size_t i = 0; i <= filesystem::max_link_hops; i++) {
+        chain.push_back(fs.create_link(chain.back(), "link_" + std::to_string(i)));
+    }
+    passed &= check(throws<link_cycle>([&]() { fs.get_file_size(chain.back()); }), "a chain longer than max_link_hops throws link_cycle");
+    passed &= check(fs.get_file_size(chain[filesystem::max_link_hops]) == 7, "a chain of max_link_hops links is followed");
+    return passed;
+}
+
+/**
+ * \brief A pool policy outside the enum is rejected before it is applied or logged, so the log stays recoverable.
+ * \return If the test passed.
+ */
+static bool test_invalid_pool_policy() {
+    const std::string logPath = "filesystem-test.log";
+    const std::string snapshotPath = "filesystem-test.snapshot";
+    std::remove(logPath.c_str());
+    std::remove(snapshotPath.c_str());
+    bool passed = true;
+    {
+        filesystem fs{ 1000 };
+        fs.open_log(logPath, snapshotPath, 1);
+        fs.set_pool_policy(pool_policy::Lifo);
+        passed &= check(throws<invalid_pool_policy>([&]() { fs.set_pool_policy(static_cast<pool_policy>(3)); }), "a policy past the enum is rejected");
+        passed &= check(throws<invalid_pool_policy>([&]() { fs.set_pool_policy(static_cast<pool_policy>(-1)); }), "a negative policy is rejected");
+        fs.create_file(3, "file");
+        fs.close_log();
+    }
+    filesystem recovered{ 1000 };
+    passed &= check(!throws<std::exception>([&]() { recovered.open_log(logPath, snapshotPath, 1); }), "the log is recoverable");
+    passed &= check(recovered.get_file_size("/file") == 3, "recovery replays the operations after the rejected policy");
+    recovered.close_log();
+    std::remove(logPath.c_str());
+    std::remove(snapshotPath.c_str());
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    const std::string test = argc > 1 ? argv[1] : "all";
+    const std::vector<std::pair<std::string, std::function<bool()>>> tests = {
+        { "manifest_failure_recovery", test_manifest_failure_recovery },
+        { "file_size_link_cycle", test_file_size_link_cycle },
+        { "invalid_pool_policy", test_invalid_pool_policy },
+    };
+    bool ran = false;
+    int failed = 0;
+    for (const auto& entry : tests) {
+        if (test == "all" || test == entry.first) {
+            const bool passed = entry.second();
+            std::cout << entry.first << (passed ? ": passed" : ": FAILED") << std::endl;
+            failed += passed ? 0 : 1;
+            ran = true;
+        }
+    }
+    if (!ran) {
+        std::cerr << "Unknown test: " << test << std::endl;
+        return 1;
+    }
+    return failed;
+}
@@ -0,0 +1,51 @@
+#include "name_pool.hpp"
+
+#include "cstring"
+
+using namespace cs251;
+
+name_pool::name_pool() {
+    m_names.emplace_back();
+    m_ids.emplace(std::string_view(), 0);
+}
+
+name_id name_pool::intern(const std::string_view name) {
+    auto it = m_ids.find(name);
+    if (it != m_ids.end()) {
+        return it->second;
+    }
+    char* storage;
+    if (name.size() > block_size) {
+        m_blocks.emplace_back(new char[name.size()]);
+        storage = m_blocks.back().get();
+        // Keep filling the current block; move the long block out of the way.
+        if (m_blocks.size() > 1) {
+            std::swap(m_blocks[m_blocks.size() - 1], m_blocks[m_blocks.size() - 2]);
+        }
+    } else {
+        if (block_size - m_blockUsed < name.size()) {
+            m_blocks.emplace_back(new char[block_size]);
+            m_blockUsed = 0;
+        }
+        storage = m_blocks.back().get() + m_blockUsed;
+        m_blockUsed += name.size();
+    }
+    std::memcpy(storage, name.data(), name.size());
+    const name_id id = static_cast<name_id>(m_names.size());
+    m_names.emplace_back(storage, name.size());
+    m_ids.emplace(m_names.back(), id);
+    return id;
+}
+
+name_id name_pool::find(const std::string_view name) const {
+    auto it = m_ids.find(name);
+    return it == m_ids.end() ? npos : it->second;
+}
+
+std::string_view name_pool::view(const name_id id) const {
+    return m_names[id];
+}
+
+size_t name_pool::size() const {
+    return m_names.size();
+}
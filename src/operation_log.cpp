@@ -0,0 +1,164 @@
+#include "operation_log.hpp"
+
+#include "cstdint"
+#include "cstring"
+#include "fcntl.h"
+#include "sys/stat.h"
+#include "unistd.h"
+
+using namespace cs251;
+
+/*
+Every record is a frame of
+  uint32_t payloadLength
+  uint32_t checksum          FNV-1a of the payload
+followed by the payload
+  uint64_t sequence
+  uint32_t type
+  int32_t handle
+  int32_t target
+  uint32_t nameLength
+  uint64_t value
+  char name[nameLength]
+*/
+namespace {
+    const size_t frame_header_bytes = 2 * sizeof(uint32_t);
+    const size_t payload_fixed_bytes = sizeof(uint64_t) + 4 * sizeof(uint32_t) + sizeof(uint64_t);
+
+    uint32_t checksum(const char* data, const size_t bytes) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < bytes; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    template<typename T>
+    void append_bytes(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    T read_bytes(const char* data, size_t& offset) {
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+}
+
+operation_log::operation_log(const std::string& path, const size_t groupSize) {
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (m_fd == -1) {
+        throw log_io_error();
+    }
+    m_groupSize = groupSize == 0 ? 1 : groupSize;
+}
+
+operation_log::~operation_log() {
+    try {
+        commit();
+    } catch (const log_io_error&) {
+    }
+    close(m_fd);
+}
+
+std::vector<operation_record> operation_log::read_records() {
+    struct stat status {};
+    if (fstat(m_fd, &status) == -1) {
+        throw log_io_error();
+    }
+    std::string contents(static_cast<size_t>(status.st_size), '\0');
+    size_t loaded = 0;
+    while (loaded < contents.size()) {
+        const ssize_t result = pread(m_fd, &contents[loaded], contents.size() - loaded, static_cast<off_t>(loaded));
+        if (result < 0) {
+            throw log_io_error();
+        }
+        if (result == 0) {
+            break;
+        }
+        loaded += static_cast<size_t>(result);
+    }
+    contents.resize(loaded);
+
+    std::vector<operation_record> records;
+    size_t valid = 0;
+    while (contents.size() - valid >= frame_header_bytes) {
+        size_t offset = valid;
+        const uint32_t payloadLength = read_bytes<uint32_t>(contents.data(), offset);
+        const uint32_t expected = read_bytes<uint32_t>(contents.data(), offset);
+        if ((payloadLength < payload_fixed_bytes) || (payloadLength > contents.size() - offset)
+            || (checksum(contents.data() + offset, payloadLength) != expected)) {
+            break;
+        }
+        operation_record record;
+        record.m_sequence = read_bytes<uint64_t>(contents.data(), offset);
+        record.m_type = static_cast<operation_type>(read_bytes<uint32_t>(contents.data(), offset));
+        record.m_handle = read_bytes<int32_t>(contents.data(), offset);
+        record.m_target = read_bytes<int32_t>(contents.data(), offset);
+        const uint32_t nameLength = read_bytes<uint32_t>(contents.data(), offset);
+        record.m_value = read_bytes<uint64_t>(contents.data(), offset);
+        if (nameLength != payloadLength - payload_fixed_bytes) {
+            break;
+        }
+        record.m_name.assign(contents.data() + offset, nameLength);
+        records.push_back(std::move(record));
+        valid = offset + nameLength;
+    }
+    if (valid != contents.size()) {
+        if ((ftruncate(m_fd, static_cast<off_t>(valid)) == -1) || (fsync(m_fd) == -1)) {
+            throw log_io_error();
+        }
+    }
+    return records;
+}
+
+void operation_log::append(const operation_record& record) {
+    std::string payload;
+    append_bytes<uint64_t>(payload, record.m_sequence);
+    append_bytes<uint32_t>(payload, static_cast<uint32_t>(record.m_type));
+    append_bytes<int32_t>(payload, record.m_handle);
+    append_bytes<int32_t>(payload, record.m_target);
+    append_bytes<uint32_t>(payload, static_cast<uint32_t>(record.m_name.size()));
+    append_bytes<uint64_t>(payload, record.m_value);
+    payload += record.m_name;
+    append_bytes<uint32_t>(m_buffer, static_cast<uint32_t>(payload.size()));
+    append_bytes<uint32_t>(m_buffer, checksum(payload.data(), payload.size()));
+    m_buffer += payload;
+    m_pendingCount += 1;
+    if (m_pendingCount >= m_groupSize) {
+        commit();
+    }
+}
+
+void operation_log::commit() {
+    if (m_pendingCount == 0) {
+        return;
+    }
+    size_t written = 0;
+    while (written < m_buffer.size()) {
+        const ssize_t result = write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+        if (result <= 0) {
+            throw log_io_error();
+        }
+        written += static_cast<size_t>(result);
+    }
+    if (fdatasync(m_fd) == -1) {
+        throw log_io_error();
+    }
+    m_buffer.clear();
+    m_pendingCount = 0;
+}
+
+void operation_log::truncate() {
+    m_buffer.clear();
+    m_pendingCount = 0;
+    if ((ftruncate(m_fd, 0) == -1) || (fsync(m_fd) == -1)) {
+        throw log_io_error();
+    }
+}
+
+size_t operation_log::get_pending_count() const {
+    return m_pendingCount;
+}
@@ -0,0 +1,476 @@
+#include "partitioned_filesystem.hpp"
+
+using namespace cs251;
+
+partitioned_filesystem::partitioned_filesystem(const size_t sizeLimit, const size_t partitionCount) : m_sizeLimit(sizeLimit) {
+    const size_t count = partitionCount == 0 ? 1 : partitionCount;
+    m_partitions.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        m_partitions.push_back(std::make_unique<concurrent_filesystem>(static_cast<size_t>(-1)));
+    }
+}
+
+handle partitioned_filesystem::to_local(const handle targetHandle, size_t& partition) const {
+    if (targetHandle < 0) {
+        throw invalid_handle();
+    }
+    const handle count = static_cast<handle>(m_partitions.size());
+    partition = static_cast<size_t>(targetHandle % count);
+    const handle localHandle = targetHandle / count;
+    // The roots of the partitions other than the first have no handle of their own.
+    if ((localHandle == 0) && (partition != 0)) {
+        throw invalid_handle();
+    }
+    return localHandle;
+}
+
+handle partitioned_filesystem::to_global(const size_t partition, const handle localHandle) const {
+    if (localHandle == 0) {
+        return 0;
+    }
+    return localHandle * static_cast<handle>(m_partitions.size()) + static_cast<handle>(partition);
+}
+
+void partitioned_filesystem::reserve_size(const size_t bytes) {
+    size_t currentSize = m_currentSize.load();
+    do {
+        if (bytes > m_sizeLimit - currentSize) {
+            throw exceeds_size();
+        }
+    } while (!m_currentSize.compare_exchange_weak(currentSize, currentSize + bytes));
+}
+
+void partitioned_filesystem::release_size(const size_t bytes) {
+    m_currentSize.fetch_sub(bytes);
+}
+
+size_t partitioned_filesystem::claim_root_name(const std::string& name, const size_t partition) {
+    std::unique_lock<std::shared_mutex> lock(m_rootMutex);
+    if (m_rootPartitions.find(name) != m_rootPartitions.end()) {
+        throw name_exists();
+    }
+    size_t claimed = partition;
+    if (claimed == static_cast<size_t>(-1)) {
+        claimed = m_nextPartition;
+        m_nextPartition = (m_nextPartition + 1) % m_partitions.size();
+    }
+    m_rootPartitions.emplace(m_rootNamePool.view(m_rootNamePool.intern(name)), claimed);
+    return claimed;
+}
+
+void partitioned_filesystem::release_root_name(const std::string& name) {
+    std::unique_lock<std::shared_mutex> lock(m_rootMutex);
+    m_rootPartitions.erase(name);
+}
+
+template <typename function>
+handle partitioned_filesystem::create_entry(const handle parentHandle, const std::string& name, const node_type type, const size_t rootPartition, function create) {
+    size_t partition;
+    handle localParent = to_local(parentHandle, partition);
+    if (localParent != 0) {
+        // A link as the parent can lead to any partition, so it is followed outside this lock and the create goes there.
+        const handle localHandle = m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+            return fs.get_type(localParent) == node_type::Link ? -1 : create(fs, partition, localParent);
+        });
+        if (localHandle != -1) {
+            return to_global(partition, localHandle);
+        }
+        localParent = to_local(follow(parentHandle), partition);
+    }
+    if (localParent != 0) {
+        return to_global(partition, m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+            return create(fs, partition, localParent);
+        }));
+    }
+    try {
+        partition = claim_root_name(name, rootPartition);
+    } catch (const name_exists&) {
+        // Report a taken name by the type being created, like the creates of filesystem.
+        switch (type) {
+        case node_type::Directory: throw directory_exists();
+        case node_type::File: throw file_exists();
+        case node_type::Link: throw link_exists();
+        }
+        throw;
+    }
+    try {
+        return to_global(partition, m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+            return create(fs, partition, 0);
+        }));
+    } catch (...) {
+        release_root_name(name);
+        throw;
+    }
+}
+
+handle partitioned_filesystem::create_file(const size_t fileSize, const std::string& fileName, const handle parentHandle) {
+    reserve_size(fileSize);
+    try {
+        return create_entry(parentHandle, fileName, node_type::File, -1, [&](filesystem& fs, size_t, const handle localParent) {
+            return fs.create_file(fileSize, fileName, localParent);
+        });
+    } catch (...) {
+        release_size(fileSize);
+        throw;
+    }
+}
+
+handle partitioned_filesystem::create_directory(const std::string& directoryName, const handle parentHandle) {
+    return create_entry(parentHandle, directoryName, node_type::Directory, -1, [&](filesystem& fs, size_t, const handle localParent) {
+        return fs.create_directory(directoryName, localParent);
+    });
+}
+
+handle partitioned_filesystem::create_link(const handle targetHandle, const std::string& linkName, const handle parentHandle) {
+    tagged_handle target;
+    target.m_handle = targetHandle;
+    size_t targetPartition = -1;
+    if (targetHandle != 0) {
+        const handle localTarget = to_local(targetHandle, targetPartition);
+        target.m_generation = m_partitions[targetPartition]->with_shared([&](const filesystem& fs) {
+            return fs.get_tagged_handle(localTarget).m_generation;
+        });
+    }
+    return create_entry(parentHandle, linkName, node_type::Link, targetPartition, [&](filesystem& fs, const size_t partition, const handle localParent) {
+        // The partition only holds the link's name. Its target goes in the link table before the partition is unlocked.
+        const handle localLink = fs.create_link(0, linkName, localParent);
+        std::unique_lock<std::shared_mutex> lock(m_linkMutex);
+        m_linkTargets[to_global(partition, localLink)] = target;
+        return localLink;
+    });
+}
+
+bool partitioned_filesystem::remove(const handle targetHandle) {
+    size_t partition;
+    const handle localHandle = to_local(targetHandle, partition);
+    size_t bytes = 0;
+    std::string rootName;
+    const bool removed = m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+        const node_type type = fs.get_type(localHandle);
+        if (type == node_type::File) {
+            bytes = fs.get_file_size(localHandle);
+        }
+        if (fs.get_parent(localHandle) == 0) {
+            rootName = fs.get_name(localHandle);
+        }
+        if (!fs.remove(localHandle)) {
+            return false;
+        }
+        if (type == node_type::Link) {
+            std::unique_lock<std::shared_mutex> lock(m_linkMutex);
+            m_linkTargets.erase(targetHandle);
+        }
+        return true;
+    });
+    if (removed) {
+        release_size(bytes);
+        if (!rootName.empty()) {
+            release_root_name(rootName);
+        }
+    }
+    return removed;
+}
+
+size_t partitioned_filesystem::remove_recursive(const handle targetHandle) {
+    size_t partition;
+    const handle localHandle = to_local(targetHandle, partition);
+    size_t bytes = 0;
+    std::string rootName;
+    const size_t removed = m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+        const node_type type = fs.get_type(localHandle);
+        bool hasLinks = type == node_type::Link;
+        if (type == node_type::File) {
+            bytes = fs.get_file_size(localHandle);
+        } else if (type == node_type::Directory) {
+            bytes = fs.get_directory_size(localHandle);
+            hasLinks = fs.get_directory_usage(localHandle).m_linkCount != 0;
+        }
+        if (fs.get_parent(localHandle) == 0) {
+            rootName = fs.get_name(localHandle);
+        }
+        const size_t count = fs.remove_recursive(localHandle);
+        if (hasLinks) {
+            // Drop the removed links while the partition is still locked, before their handles can be reused.
+            const handle partitionCount = static_cast<handle>(m_partitions.size());
+            std::unique_lock<std::shared_mutex> lock(m_linkMutex);
+            for (auto it = m_linkTargets.begin(); it != m_linkTargets.end();) {
+                if ((static_cast<size_t>(it->first % partitionCount) == partition) && !fs.exist(it->first / partitionCount)) {
+                    it = m_linkTargets.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return count;
+    });
+    release_size(bytes);
+    if (!rootName.empty()) {
+        release_root_name(rootName);
+    }
+    return removed;
+}
+
+void partitioned_filesystem::resize_file(const handle targetHandle, const size_t newSize) {
+    size_t partition;
+    handle localHandle = to_local(targetHandle, partition);
+    const auto resize = [&](filesystem& fs) {
+        const size_t oldSize = fs.peek_file_size(localHandle);
+        if (newSize <= oldSize) {
+            fs.resize_file(localHandle, newSize);
+            release_size(oldSize - newSize);
+            return;
+        }
+        reserve_size(newSize - oldSize);
+        try {
+            fs.resize_file(localHandle, newSize);
+        } catch (...) {
+            release_size(newSize - oldSize);
+            throw;
+        }
+    };
+    const bool resized = m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+        // A link can lead to another partition, so it is followed outside this lock.
+        if (fs.get_type(localHandle) == node_type::Link) {
+            return false;
+        }
+        resize(fs);
+        return true;
+    });
+    if (!resized) {
+        localHandle = to_local(follow(targetHandle), partition);
+        m_partitions[partition]->with_exclusive(resize);
+    }
+}
+
+void partitioned_filesystem::rename(const handle targetHandle, const std::string& newName) {
+    size_t partition;
+    const handle localHandle = to_local(targetHandle, partition);
+    m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+        if ((localHandle == 0) || (fs.get_parent(localHandle) != 0)) {
+            fs.rename(localHandle, newName);
+            return;
+        }
+        const std::string oldName = fs.get_name(localHandle);
+        claim_root_name(newName, partition);
+        try {
+            fs.rename(localHandle, newName);
+        } catch (...) {
+            release_root_name(newName);
+            throw;
+        }
+        release_root_name(oldName);
+    });
+}
+
+void partitioned_filesystem::move(const handle targetHandle, const handle parentHandle) {
+    size_t partition;
+    size_t parentPartition;
+    const handle localHandle = to_local(targetHandle, partition);
+    const handle localParent = to_local(follow(parentHandle), parentPartition);
+    if ((localParent != 0) && (parentPartition != partition)) {
+        throw invalid_handle();
+    }
+    m_partitions[partition]->with_exclusive([&](filesystem& fs) {
+        const handle oldParent = fs.get_parent(localHandle);
+        const bool toRoot = localParent == 0;
+        if ((oldParent == 0) == toRoot) {
+            fs.move(localHandle, localParent);
+            return;
+        }
+        const std::string name = fs.get_name(localHandle);
+        if (toRoot) {
+            claim_root_name(name, partition);
+            try {
+                fs.move(localHandle, localParent);
+            } catch (...) {
+                release_root_name(name);
+                throw;
+            }
+        } else {
+            fs.move(localHandle, localParent);
+            release_root_name(name);
+        }
+    });
+}
+
+handle partitioned_filesystem::get_handle(const std::string_view path) const {
+    if (path.empty() || (path[0] != '/')) {
+        throw invalid_path();
+    }
+    if (path.size() == 1) {
+        return 0;
+    }
+    // Walk one partition at a time. Climbing back to the root or following a link can lead to another partition,
+    // so the walk leaves the partition there and continues from the global handle it reached.
+    handle directoryHandle = 0;
+    size_t begin = 1;
+    while (true) {
+        size_t partition;
+        handle localHandle;
+        if (directoryHandle == 0) {
+            const size_t end = path.find('/', begin);
+            const std::string_view name = path.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+            if ((name == ".") || (name == "..")) {
+                if (end == std::string_view::npos) {
+                    return 0;
+                }
+                begin = end + 1;
+                continue;
+            }
+            {
+                std::shared_lock<std::shared_mutex> lock(m_rootMutex);
+                auto it = m_rootPartitions.find(name);
+                if (it == m_rootPartitions.end()) {
+                    throw invalid_path();
+                }
+                partition = it->second;
+            }
+            localHandle = 0;
+        } else {
+            localHandle = to_local(directoryHandle, partition);
+        }
+        handle resultHandle = -1;
+        handle linkHandle = -1;
+        m_partitions[partition]->with_shared([&](const filesystem& fs) {
+            while (true) {
+                const size_t end = path.find('/', begin);
+                const std::string_view name = path.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+                handle childHandle;
+                if (name == ".") {
+                    childHandle = localHandle;
+                } else if (name == "..") {
+                    childHandle = fs.get_parent(localHandle);
+                } else {
+                    childHandle = fs.peek_handle(name, localHandle);
+                }
+                if (end == std::string_view::npos) {
+                    resultHandle = to_global(partition, childHandle);
+                    return;
+                }
+                begin = end + 1;
+                if (childHandle == 0) {
+                    return;
+                }
+                const node_type type = fs.get_type(childHandle);
+                if (type == node_type::Link) {
+                    linkHandle = to_global(partition, childHandle);
+                    return;
+                }
+                if (type != node_type::Directory) {
+                    throw invalid_path();
+                }
+                localHandle = childHandle;
+            }
+        });
+        if (resultHandle != -1) {
+            return resultHandle;
+        }
+        directoryHandle = 0;
+        if (linkHandle != -1) {
+            node_type type;
+            directoryHandle = follow(linkHandle, type);
+            if (type != node_type::Directory) {
+                throw invalid_path();
+            }
+        }
+    }
+}
+
+handle partitioned_filesystem::follow(const handle targetHandle) const {
+    node_type type;
+    return follow(targetHandle, type);
+}
+
+handle partitioned_filesystem::follow(const handle targetHandle, node_type& type) const {
+    tagged_handle current;
+    current.m_handle = targetHandle;
+    type = node_type::Directory;
+    for (size_t hops = 0; current.m_handle != 0; hops++) {
+        size_t partition;
+        const handle localHandle = to_local(current.m_handle, partition);
+        const bool isLink = m_partitions[partition]->with_shared([&](const filesystem& fs) {
+            // A target removed since the link was made fails its generation check, leaving the link dangling.
+            tagged_handle localTarget;
+            localTarget.m_handle = localHandle;
+            localTarget.m_generation = current.m_generation;
+            if ((hops > 0) && !fs.exist(localTarget)) {
+                throw invalid_handle();
+            }
+            type = fs.get_type(localHandle);
+            if (type != node_type::Link) {
+                return false;
+            }
+            std::shared_lock<std::shared_mutex> lock(m_linkMutex);
+            current = m_linkTargets.at(current.m_handle);
+            return true;
+        });
+        if (!isLink) {
+            return current.m_handle;
+        }
+        if (hops == filesystem::max_link_hops) {
+            throw link_cycle();
+        }
+    }
+    type = node_type::Directory;
+    return 0;
+}
+
+bool partitioned_filesystem::exist(const handle targetHandle) const {
+    if (targetHandle < 0) {
+        return false;
+    }
+    const size_t partition = static_cast<size_t>(targetHandle) % m_partitions.size();
+    if ((targetHandle != 0) && (static_cast<size_t>(targetHandle) < m_partitions.size())) {
+        return false;
+    }
+    return m_partitions[partition]->exist(targetHandle / static_cast<handle>(m_partitions.size()));
+}
+
+std::string partitioned_filesystem::get_name(const handle targetHandle) const {
+    size_t partition;
+    const handle localHandle = to_local(targetHandle, partition);
+    return m_partitions[partition]->get_name(localHandle);
+}
+
+size_t partitioned_filesystem::get_file_size(const handle targetHandle) const {
+    size_t partition;
+    const handle localHandle = to_local(targetHandle, partition);
+    bool isLink = false;
+    const size_t fileSize = m_partitions[partition]->with_shared([&](const filesystem& fs) {
+        isLink = fs.get_type(localHandle) == node_type::Link;
+        return isLink ? 0 : fs.peek_file_size(localHandle);
+    });
+    if (!isLink) {
+        return fileSize;
+    }
+    const handle fileHandle = to_local(follow(targetHandle), partition);
+    return m_partitions[partition]->get_file_size(fileHandle);
+}
+
+handle partitioned_filesystem::get_largest_file_handle() const {
+    handle largestHandle = -1;
+    size_t largestSize = 0;
+    for (size_t partition = 0; partition < m_partitions.size(); partition++) {
+        m_partitions[partition]->with_shared([&](const filesystem& fs) {
+            handle fileHandle;
+            try {
+                fileHandle = fs.get_largest_file_handle();
+            } catch (const heap_empty&) {
+                return;
+            }
+            const size_t fileSize = fs.peek_file_size(fileHandle);
+            if ((largestHandle == -1) || (fileSize > largestSize)) {
+                largestHandle = to_global(partition, fileHandle);
+                largestSize = fileSize;
+            }
+        });
+    }
+    if (largestHandle == -1) {
+        throw heap_empty();
+    }
+    return largestHandle;
+}
+
+size_t partitioned_filesystem::get_available_size() const {
+    return m_sizeLimit - m_currentSize.load();
+}
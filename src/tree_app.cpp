@@ -91,7 +91,7 @@ template <typename T> void run_test() {
 				std::cout << node.ref_data() << std::endl;
 				std::cout << "parent: " << node.get_parent_handle() << std::endl;
 				std::cout << "children: ";
-				for (auto child_id : node.peek_children_handles()) {
+				for (auto child_id : t.peek_children(node_id)) {
 					std::cout << child_id << " ";
 				}
 				std::cout << std::endl;
@@ -0,0 +1,301 @@
+#include "filesystem.hpp"
+
+#include "iostream"
+#include "chrono"
+#include "cstdlib"
+#include "random"
+#include "algorithm"
+#include "cmath"
+#ifdef __linux__
+#include "linux/perf_event.h"
+#include "sys/ioctl.h"
+#include "sys/syscall.h"
+#include "unistd.h"
+#endif
+using namespace cs251;
+/*
+Micro benchmarks for the tree storage, built as a separate executable next to tree-app.
+Usage: tree-bench [benchmark|all] [nodes]
+Cache misses are read from the hardware counters when perf events are available, and reported as n/a otherwise.
+*/
+
+/**
+ * Counts last level cache misses of the calling thread through perf events.
+ */
+class cache_miss_counter {
+public:
+	cache_miss_counter() {
+#ifdef __linux__
+		perf_event_attr attr{};
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+	}
+	~cache_miss_counter() {
+#ifdef __linux__
+		if (m_fd != -1) {
+			close(m_fd);
+		}
+#endif
+	}
+	void start() {
+#ifdef __linux__
+		if (m_fd != -1) {
+			ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	/**
+	 * \brief Stop counting.
+	 * \return The amount of cache misses since start, as text.
+	 */
+	std::string stop() {
+#ifdef __linux__
+		long long count = 0;
+		if (m_fd != -1) {
+			ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(m_fd, &count, sizeof(count)) == sizeof(count)) {
+				return std::to_string(count);
+			}
+		}
+#endif
+		return "n/a";
+	}
+private:
+	int m_fd = -1;
+};
+
+/**
+ * \brief Get the seconds elapsed since a point in time.
+ * \param start The starting point.
+ * \return The elapsed seconds.
+ */
+static double seconds_since(const std::chrono::steady_clock::time_point& start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * \brief Build a random tree of filesystem nodes and churn it so parents and children are scattered in storage.
+ * \param t The tree to fill.
+ * \param nodes The amount of live nodes to end up with.
+ * \return The handles of the live nodes.
+ */
+static std::vector<handle> build_scattered_tree(tree<filesystem_node_data>& t, const size_t nodes) {
+	std::mt19937 random{ 251 };
+	std::vector<handle> handles{ 0 };
+	filesystem_node_data data;
+	while (handles.size() < nodes) {
+		handles.push_back(t.allocate(handles[random() % handles.size()], data));
+		if (random() % 8 == 0) {
+			const handle leaf = t.allocate(handles[random() % handles.size()], data);
+			t.remove(leaf);
+		}
+	}
+	std::shuffle(handles.begin(), handles.end(), random);
+	return handles;
+}
+
+/**
+ * \brief Walk from many nodes up to the root, through whole nodes and through the dense parent array.
+ * \param nodes The amount of nodes in the tree.
+ */
+static void bench_ancestor_walk(const size_t nodes) {
+	tree<filesystem_node_data> t;
+	const std::vector<handle> handles = build_scattered_tree(t, nodes);
+	cache_miss_counter counter;
+	for (bool dense : {false, true}) {
+		size_t steps = 0;
+		counter.start();
+		const auto start = std::chrono::steady_clock::now();
+		for (handle h : handles) {
+			while (h != -1) {
+				h = dense ? t.get_parent(h) : t.ref_node(h).get_parent_handle();
+				steps++;
+			}
+		}
+		const double seconds = seconds_since(start);
+		const std::string misses = counter.stop();
+		std::cout << "ancestor_walk [" << (dense ? "dense parents" : "whole nodes") << "]: " << steps << " steps in " << seconds
+			<< " s, " << (seconds * 1e9 / steps) << " ns/step, cache misses " << misses << ", "
+			<< (dense ? sizeof(handle) : sizeof(tree_node<filesystem_node_data>)) << " bytes/node" << std::endl;
+	}
+}
+
+/**
+ * \brief Count live nodes, through whole nodes and through the dense liveness flags.
+ * \param nodes The amount of nodes in the tree.
+ */
+static void bench_liveness_scan(const size_t nodes) {
+	tree<filesystem_node_data> t;
+	build_scattered_tree(t, nodes);
+	const handle count = static_cast<handle>(t.peek_nodes().size());
+	cache_miss_counter counter;
+	for (bool dense : {false, true}) {
+		size_t alive = 0;
+		counter.start();
+		const auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < 10; round++) {
+			if (dense) {
+				for (handle h = 0; h < count; h++) {
+					alive += t.is_alive(h);
+				}
+			} else {
+				for (const auto& node : t.peek_nodes()) {
+					alive += !node.is_recycled();
+				}
+			}
+		}
+		const double seconds = seconds_since(start);
+		const std::string misses = counter.stop();
+		std::cout << "liveness_scan [" << (dense ? "dense flags" : "whole nodes") << "]: " << alive << " live in " << seconds
+			<< " s, cache misses " << misses << std::endl;
+	}
+}
+
+/**
+ * \brief Time every allocation of a growing tree on its own and report the percentiles, with and without reserving the storage.
+ * \param nodes The amount of nodes to allocate.
+ */
+static void bench_allocate_latency(const size_t nodes) {
+	for (bool reserved : {false, true}) {
+		tree<filesystem_node_data> t;
+		if (reserved) {
+			t.reserve(nodes + 1);
+		}
+		std::vector<double> latencies;
+		latencies.reserve(nodes);
+		filesystem_node_data data;
+		data.m_type = node_type::File;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < nodes; i++) {
+			const auto before = std::chrono::steady_clock::now();
+			t.allocate(static_cast<handle>(i / 16), data);
+			latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - before).count());
+		}
+		const double seconds = seconds_since(start);
+		std::sort(latencies.begin(), latencies.end());
+		std::cout << "allocate_latency [" << (reserved ? "reserved" : "growing") << "]: " << nodes << " allocations in " << seconds
+			<< " s, p50 " << latencies[latencies.size() / 2] << " us, p99 " << latencies[latencies.size() * 99 / 100]
+			<< " us, p99.99 " << latencies[latencies.size() * 9999 / 10000] << " us, max " << latencies.back() << " us" << std::endl;
+	}
+}
+
+/**
+ * \brief Walk the whole tree in preorder over the sibling links, reading every node.
+ * \param t The tree.
+ * \param distance Set to the mean distance in storage between a node and its parent.
+ * \return The amount of nodes visited.
+ */
+static size_t walk_preorder(tree<filesystem_node_data>& t, double& distance) {
+	size_t visited = 0;
+	double total = 0;
+	handle current = 0;
+	while (true) {
+		const tree_node<filesystem_node_data>& node = t.ref_node(current);
+		visited++;
+		if (current != 0) {
+			total += std::abs(current - node.get_parent_handle());
+		}
+		if (node.get_first_child_handle() != -1) {
+			current = node.get_first_child_handle();
+			continue;
+		}
+		while ((current != 0) && (t.ref_node(current).get_next_sibling_handle() == -1)) {
+			current = t.ref_node(current).get_parent_handle();
+		}
+		if (current == 0) {
+			break;
+		}
+		current = t.ref_node(current).get_next_sibling_handle();
+	}
+	distance = visited > 1 ? total / (visited - 1) : 0;
+	return visited;
+}
+
+/**
+ * \brief Churn a tree with each pool policy, then walk it in preorder before and after compacting it.
+ * \param nodes The amount of live nodes.
+ */
+static void bench_churn_locality(const size_t nodes) {
+	const std::pair<pool_policy, const char*> policies[] = {
+		{ pool_policy::Fifo, "fifo" }, { pool_policy::Lifo, "lifo" }, { pool_policy::NearParent, "near parent" } };
+	for (const auto& policy : policies) {
+		tree<filesystem_node_data> t;
+		t.set_pool_policy(policy.first);
+		std::mt19937 random{ 251 };
+		std::vector<handle> handles{ 0 };
+		filesystem_node_data data;
+		while (handles.size() < nodes) {
+			handles.push_back(t.allocate(handles[random() % handles.size()], data));
+		}
+		// Replace batches of random leaves with new nodes under random parents, as long-running churn does.
+		std::vector<size_t> batch;
+		for (size_t round = 0; round < nodes * 2 / 1024; round++) {
+			batch.clear();
+			for (size_t i = 0; i < 1024; i++) {
+				const size_t index = 1 + random() % (handles.size() - 1);
+				if ((handles[index] != -1) && (t.ref_node(handles[index]).get_child_count() == 0)) {
+					t.remove(handles[index]);
+					handles[index] = -1;
+					batch.push_back(index);
+				}
+			}
+			for (const size_t index : batch) {
+				handle parentHandle = -1;
+				while (parentHandle == -1) {
+					parentHandle = handles[random() % index];
+				}
+				handles[index] = t.allocate(parentHandle, data);
+			}
+		}
+		const size_t slots = t.peek_nodes().size();
+		for (bool compacted : {false, true}) {
+			if (compacted) {
+				t.compact();
+			}
+			double distance = 0;
+			size_t visited = 0;
+			const auto start = std::chrono::steady_clock::now();
+			for (int round = 0; round < 10; round++) {
+				visited += walk_preorder(t, distance);
+			}
+			const double seconds = seconds_since(start);
+			std::cout << "churn_locality [" << policy.second << (compacted ? ", compacted" : "") << "]: " << visited << " nodes in "
+				<< seconds << " s, " << (seconds * 1e9 / visited) << " ns/node, mean parent distance " << distance << ", "
+				<< (compacted ? t.peek_nodes().size() : slots) << " slots" << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::string benchmark = argc > 1 ? argv[1] : "all";
+	const size_t nodes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+	bool ran = false;
+	if (benchmark == "all" || benchmark == "ancestor_walk") {
+		bench_ancestor_walk(nodes);
+		ran = true;
+	}
+	if (benchmark == "all" || benchmark == "liveness_scan") {
+		bench_liveness_scan(nodes);
+		ran = true;
+	}
+	if (benchmark == "all" || benchmark == "allocate_latency") {
+		bench_allocate_latency(nodes * 4);
+		ran = true;
+	}
+	if (benchmark == "all" || benchmark == "churn_locality") {
+		bench_churn_locality(nodes);
+		ran = true;
+	}
+	if (!ran) {
+		std::cerr << "Unknown benchmark: " << benchmark << std::endl;
+		return 1;
+	}
+	return 0;
+}